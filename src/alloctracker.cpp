@@ -0,0 +1,180 @@
+#include "./alloctracker.h"
+
+#if ALLOC_TRACKER
+#include "./profiler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// everything reachable from operator new must not allocate itself (plain statics and trivially initialized thread locals only)
+
+static const int ZONE_SLOTS = 256; // power of two
+static const char NO_ZONE[] = "(no zone)";
+
+struct ZoneSlot {
+    std::atomic<const char*> zone; // null if unused (claimed once, never released)
+    std::atomic<unsigned long long> allocations;
+    std::atomic<unsigned long long> bytes;
+};
+
+static ZoneSlot zoneSlots[ZONE_SLOTS];
+static std::atomic<unsigned long long> totalAllocations(0);
+static std::atomic<unsigned long long> totalFrees(0);
+static std::atomic<unsigned long long> totalBytes(0);
+static thread_local unsigned long long threadAllocations = 0;
+static thread_local unsigned long long threadFrees = 0;
+static thread_local unsigned long long threadBytes = 0;
+
+static void recordAllocation(std::size_t size) {
+    totalAllocations.fetch_add(1, std::memory_order_relaxed);
+    totalBytes.fetch_add(size, std::memory_order_relaxed);
+    threadAllocations++;
+    threadBytes += size;
+
+    // zone names are string literals, so the pointer identifies the zone
+#if PROFILER
+    const char* zone = Profiler::zone();
+#else
+    const char* zone = nullptr;
+#endif
+    if (zone == nullptr) zone = NO_ZONE;
+    std::size_t h = (std::size_t)(((std::uintptr_t)zone >> 3) * 0x9E3779B97F4A7C15ull >> 32);
+    for (int probe = 0; probe < ZONE_SLOTS; ++probe) {
+        ZoneSlot& slot = zoneSlots[(h + probe) & (ZONE_SLOTS - 1)];
+        const char* current = slot.zone.load(std::memory_order_acquire);
+        if (current == nullptr && slot.zone.compare_exchange_strong(current, zone, std::memory_order_acq_rel))
+            current = zone;
+        if (current != zone) continue;
+        slot.allocations.fetch_add(1, std::memory_order_relaxed);
+        slot.bytes.fetch_add(size, std::memory_order_relaxed);
+        return;
+    }
+    // table full: only counted in totals
+}
+
+static void recordFree() {
+    totalFrees.fetch_add(1, std::memory_order_relaxed);
+    threadFrees++;
+}
+
+static void* allocate(std::size_t size) {
+    void* p = std::malloc(size != 0 ? size : 1);
+    if (p != nullptr) recordAllocation(size);
+    return p;
+}
+
+static void* allocateAligned(std::size_t size, std::size_t alignment) {
+    void* p = nullptr;
+#ifdef _WIN32
+    p = _aligned_malloc(size != 0 ? size : 1, alignment);
+#else
+    if (posix_memalign(&p, alignment < sizeof(void*) ? sizeof(void*) : alignment, size != 0 ? size : 1) != 0) p = nullptr;
+#endif
+    if (p != nullptr) recordAllocation(size);
+    return p;
+}
+
+static void release(void* p) {
+    if (p == nullptr) return;
+    recordFree();
+    std::free(p);
+}
+
+static void releaseAligned(void* p) {
+    if (p == nullptr) return;
+    recordFree();
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+AllocTracker::Counts AllocTracker::total() {
+    return { totalAllocations.load(std::memory_order_relaxed), totalFrees.load(std::memory_order_relaxed), totalBytes.load(std::memory_order_relaxed) };
+}
+
+AllocTracker::Counts AllocTracker::thread() {
+    return { threadAllocations, threadFrees, threadBytes };
+}
+
+void AllocTracker::zones(std::vector<ZoneCounts>& out) {
+    out.clear();
+    out.reserve(ZONE_SLOTS);
+    for (ZoneSlot& slot : zoneSlots) {
+        const char* zone = slot.zone.load(std::memory_order_acquire);
+        if (zone == nullptr) continue;
+        out.push_back({ zone, slot.allocations.load(std::memory_order_relaxed), slot.bytes.load(std::memory_order_relaxed) });
+    }
+}
+
+std::string AllocTracker::describe(const std::vector<ZoneCounts>& before, const std::vector<ZoneCounts>& after) {
+    std::string s;
+    for (const ZoneCounts& now : after) {
+        ZoneCounts then = { now.zone, 0, 0 };
+        for (const ZoneCounts& b : before)
+            if (b.zone == now.zone) then = b;
+        if (now.allocations == then.allocations) continue;
+        s += std::string(now.zone) + ": " + std::to_string(now.allocations - then.allocations) + " allocations, "
+            + std::to_string(now.bytes - then.bytes) + " bytes\n";
+    }
+    return s;
+}
+
+// global allocation functions
+
+void* operator new(std::size_t size) {
+    void* p = allocate(size);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    void* p = allocate(size);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    void* p = allocateAligned(size, (std::size_t)alignment);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    void* p = allocateAligned(size, (std::size_t)alignment);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, (std::size_t)alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, (std::size_t)alignment);
+}
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, std::size_t) noexcept { release(p); }
+void operator delete[](void* p, std::size_t) noexcept { release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete(void* p, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned(p); }
+#endif
@@ -0,0 +1,40 @@
+#ifndef ALLOCTRACKER_H
+#define ALLOCTRACKER_H
+
+#define ALLOC_TRACKER true // count heap allocations through global operator new (compiled out entirely if false)
+
+#if ALLOC_TRACKER
+#include <string>
+#include <vector>
+
+// heap allocation counters (global operator new/delete are replaced in alloctracker.cpp)
+// allocations are attributed to the innermost profiler zone open on the allocating thread
+class AllocTracker {
+public:
+    struct Counts {
+        unsigned long long allocations;
+        unsigned long long frees;
+        unsigned long long bytes; // allocated
+    };
+
+    struct ZoneCounts {
+        const char* zone; // "(no zone)" for allocations outside of any zone
+        unsigned long long allocations;
+        unsigned long long bytes;
+    };
+
+    // all threads since start
+    static Counts total();
+
+    // calling thread since it started (cheap, take one before and after a frame to get per frame counts)
+    static Counts thread();
+
+    // per zone since start, all threads (reuses out's capacity, so a reserved vector snapshots without allocating)
+    static void zones(std::vector<ZoneCounts>& out);
+
+    // zones that allocated between two zones() snapshots, one per line
+    static std::string describe(const std::vector<ZoneCounts>& before, const std::vector<ZoneCounts>& after);
+};
+#endif
+
+#endif
@@ -1,53 +1,307 @@
-#include <SFML/Audio.hpp>
+#include "./audio.h"
+#include "./profiler.h"
 
-#include <list>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <chrono>
 
-class SoundEffect {
-private:
-    sf::SoundBuffer buffer;
-    std::list<sf::Sound> sounds;
-public:
-    SoundEffect(std::string path) {
-        if (!buffer.loadFromFile(path))
-            throw("cannot load audio from path " + path);
+std::vector<SoundEffect::Voice> SoundEffect::voices = std::vector<SoundEffect::Voice>();
+int SoundEffect::freeHead = -1;
+int SoundEffect::activeHead = -1;
+int SoundEffect::activeTail = -1;
+int SoundEffect::activeCount = 0;
+unsigned long long SoundEffect::currentTick = 0;
+std::vector<SoundEffect*> SoundEffect::effects = std::vector<SoundEffect*>();
+
+SoundEffect::SoundEffect(std::string path, int maxVoices, int priority)
+    : maxVoices(std::min(maxVoices, MAX_VOICES)), priority(priority), head(-1), tail(-1), count(0), lastPlayTick(ULLONG_MAX) {
+    if (!sample.loadFromFile(path))
+        throw("cannot load audio from path " + path);
+    initPool();
+    effects.push_back(this);
+}
+
+SoundEffect::~SoundEffect() {
+    stop(); // blocks until every stop is queued
+    Mixer::flush(); // mixer may still be reading sample
+    effects.erase(std::remove(effects.begin(), effects.end(), this), effects.end());
+}
+
+void SoundEffect::initPool() {
+    if (voices.size() != 0) return;
+    voices = std::vector<Voice>(MAX_VOICES);
+    for (int i = 0; i < MAX_VOICES; ++i)
+        voices[i].next = i + 1 < MAX_VOICES ? i + 1 : -1;
+    freeHead = 0;
+}
+
+int SoundEffect::acquire(SoundEffect& requester) {
+    // over own limit: reuse own oldest voice
+    if (requester.count >= requester.maxVoices) {
+        if (requester.head == -1 || !release(requester.head)) return -1;
     }
 
-    void play() {
-        sounds.emplace_back(buffer);
-        sounds.back().play();
+    // pool full: steal oldest voice of the lowest priority (never from higher priority effects)
+    if (freeHead == -1) {
+        int victim = -1;
+        for (int v = activeHead; v != -1; v = voices[v].next)
+            if (victim == -1 || voices[v].owner->priority < voices[victim].owner->priority)
+                victim = v;
+        if (victim == -1 || voices[victim].owner->priority > requester.priority || !release(victim)) return -1;
     }
 
-    void clean() {
-        while (!sounds.front().getStatus())
-            sounds.pop_front();
+    // take free voice
+    int v = freeHead;
+    Voice& voice = voices[v];
+    freeHead = voice.next;
+    voice.owner = &requester;
+
+    // append to global active list
+    voice.prev = activeTail;
+    voice.next = -1;
+    if (activeTail != -1) voices[activeTail].next = v;
+    else activeHead = v;
+    activeTail = v;
+    activeCount++;
+
+    // append to owner's active list
+    voice.ownerPrev = requester.tail;
+    voice.ownerNext = -1;
+    if (requester.tail != -1) voices[requester.tail].ownerNext = v;
+    else requester.head = v;
+    requester.tail = v;
+    requester.count++;
+    return v;
+}
+
+bool SoundEffect::release(int v) {
+    // the voice stays taken until the mixer is told to stop it (it would keep playing a reused voice)
+    if (!Mixer::stop(v)) return false;
+    unlink(v);
+    return true;
+}
+
+void SoundEffect::unlink(int v) {
+    Voice& voice = voices[v];
+    SoundEffect& owner = *voice.owner;
+
+    // unlink from owner's active list
+    if (voice.ownerPrev != -1) voices[voice.ownerPrev].ownerNext = voice.ownerNext;
+    else owner.head = voice.ownerNext;
+    if (voice.ownerNext != -1) voices[voice.ownerNext].ownerPrev = voice.ownerPrev;
+    else owner.tail = voice.ownerPrev;
+    owner.count--;
+
+    // unlink from global active list
+    if (voice.prev != -1) voices[voice.prev].next = voice.next;
+    else activeHead = voice.next;
+    if (voice.next != -1) voices[voice.next].prev = voice.prev;
+    else activeTail = voice.prev;
+    activeCount--;
+
+    // push to free list
+    voice.owner = nullptr;
+    voice.prev = voice.ownerPrev = voice.ownerNext = -1;
+    voice.next = freeHead;
+    freeHead = v;
+}
+
+bool SoundEffect::play() {
+    // same sound many times in one tick only sounds louder
+    if (lastPlayTick == currentTick) return false;
+    int v = acquire(*this);
+    if (v == -1) return false;
+    if (!Mixer::play(v, sample, Mixer::sfx, 1.f)) {
+        unlink(v); // never reached the mixer, nothing to stop
+        return false;
     }
-};
+    lastPlayTick = currentTick;
+    return true;
+}
+
+void SoundEffect::stop() {
+    while (head != -1)
+        if (!release(head)) Mixer::flush(); // queue full: wait for the mixer to drain it
+}
+
+void SoundEffect::tick() {
+    PROFILE_ZONE("SoundEffect::tick");
+    currentTick++;
+
+    // voices of an effect finish in the order they started, so only the oldest ones need checking
+    for (SoundEffect* effect : effects)
+        while (effect->head != -1 && !Mixer::isPlaying(effect->head))
+            if (!release(effect->head)) return; // queue full: retried next tick
+}
+
+MusicTrack::MusicTrack(std::string startPath, std::string loopPath) : introPath(startPath) {
+    open(introFile, startPath);
+    open(loopFile, loopPath);
+    if (introFile->getChannelCount() != loopFile->getChannelCount() || introFile->getSampleRate() != loopFile->getSampleRate())
+        throw("intro and loop audio formats differ: " + startPath + ", " + loopPath);
+    intro = { introFile.get(), 0, introFile->getSampleCount() };
+    loop = { loopFile.get(), 0, loopFile->getSampleCount() };
+    init();
+}
+
+MusicTrack::MusicTrack(std::string path, sf::Uint64 loopBegin, sf::Uint64 loopEnd) {
+    open(loopFile, path);
+    if (loopBegin >= loopEnd || loopEnd > loopFile->getSampleCount() || loopBegin % loopFile->getChannelCount() != 0 || loopEnd % loopFile->getChannelCount() != 0)
+        throw("invalid loop points for audio " + path);
+    intro = { loopFile.get(), 0, loopEnd };
+    loop = { loopFile.get(), loopBegin, loopEnd };
+    init();
+}
+
+MusicTrack::~MusicTrack() {
+    while (!Mixer::stopMusic(*this)) Mixer::flush(); // a dropped stop would leave the mixer reading freed rings
+    Mixer::flush();
+    stopDecoder();
+}
+
+void MusicTrack::open(std::unique_ptr<sf::InputSoundFile>& file, const std::string& path) {
+    file = std::make_unique<sf::InputSoundFile>();
+    if (!file->openFromFile(path))
+        throw("cannot load audio from path " + path);
+}
 
-class MusicTrack {
-private:
-    int status;
-    sf::Music startMusic;
-    sf::Music loopMusic;
-public:
-    bool loop;
-    MusicTrack(std::string startPath, std::string loopPath) : status(0) {
-        if (!startMusic.openFromFile(startPath))
-            throw("cannot load audio from path " + startPath);
-        if (!loopMusic.openFromFile(loopPath))
-            throw("cannot load audio from path " + loopPath);
-        loopMusic.setLoop(true);
+void MusicTrack::init() {
+    channelCount = loopFile->getChannelCount();
+    if (loopFile->getSampleRate() != Mixer::SAMPLE_RATE || channelCount == 0 || channelCount > Mixer::CHANNELS)
+        throw("music must be mono or stereo at " + std::to_string(Mixer::SAMPLE_RATE) + "hz");
+
+    // one second read ahead
+    for (Ring& ring : rings) {
+        ring.data = std::vector<sf::Int16>(Mixer::SAMPLE_RATE * channelCount);
+        ring.readCount = 0;
+        ring.writeCount = 0;
     }
+    reading = 0;
+    decodeSize = 4096 / channelCount * channelCount;
+    seekOffset = 0;
+    seekRequested = 0;
+    seekDone = 0;
+    reposition(sf::Time::Zero);
+    while (rings[0].writeCount < decodeSize * 4 && decodeInto(rings[0])) {} // start with audio ready
+
+    // the decoder runs for the whole life of the track (seeks are served by it)
+    decoding = true;
+    decoder = std::thread(&MusicTrack::decode, this);
+}
+
+void MusicTrack::stopDecoder() {
+    decoding = false;
+    if (decoder.joinable())
+        decoder.join();
+}
 
-    void play() {
-        status = 1;
-        startMusic.play();
+void MusicTrack::seek(sf::Time offset) {
+    seekOffset.store(offset.asMicroseconds(), std::memory_order_relaxed);
+    seekRequested.fetch_add(1, std::memory_order_release);
+}
+
+void MusicTrack::decode() {
+    PROFILE_THREAD("music decoder");
+    while (decoding) {
+        unsigned int request = seekRequested.load(std::memory_order_acquire);
+        if (request != seekDone.load(std::memory_order_relaxed)) {
+            seekDecoder(request);
+            continue;
+        }
+
+        // wait for space
+        if (!decodeInto(rings[reading.load(std::memory_order_relaxed) & 1]))
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
     }
+}
+
+bool MusicTrack::decodeInto(Ring& ring) {
+    std::size_t written = ring.writeCount.load(std::memory_order_relaxed);
+    std::size_t space = ring.data.size() - (written - ring.readCount.load(std::memory_order_acquire));
+    if (space < decodeSize) return false;
 
-    void checkLoop() {
-        if (status != 1) return;
-        if (!startMusic.getStatus()) {
-            loopMusic.play();
-            status = 2;
+    // end of section: intro moves on to loop, loop wraps around
+    Section& section = inIntro ? intro : loop;
+    if (position >= section.end) {
+        if (inIntro) {
+            inIntro = false;
+            intro.file = nullptr;
+            introFile.reset();
         }
+        position = loop.begin;
+        loop.file->seek(position);
+        return true;
+    }
+
+    // decode straight into ring
+    PROFILE_ZONE("MusicTrack::decode");
+    std::size_t w = written % ring.data.size();
+    std::size_t count = std::min<sf::Uint64>(std::min(decodeSize, ring.data.size() - w), section.end - position);
+    sf::Uint64 read = section.file->read(&ring.data[w], count);
+    if (read == 0) { // file shorter than reported
+        position = section.end;
+        return true;
+    }
+    position += read;
+    ring.writeCount.store(written + read, std::memory_order_release);
+    return true;
+}
+
+void MusicTrack::seekDecoder(unsigned int request) {
+    PROFILE_ZONE("MusicTrack::seek");
+    reposition(sf::microseconds(seekOffset.load(std::memory_order_relaxed)));
+
+    // the spare ring is never read, so it can be reset and filled ahead (a few chunks, the rest follows after the swap)
+    unsigned int current = reading.load(std::memory_order_relaxed) & 1;
+    Ring& spare = rings[current ^ 1];
+    spare.readCount.store(0, std::memory_order_relaxed);
+    spare.writeCount.store(0, std::memory_order_relaxed);
+    while (decoding && spare.writeCount.load(std::memory_order_relaxed) < decodeSize * 4 && decodeInto(spare)) {}
+    reading.fetch_xor(1, std::memory_order_acq_rel);
+
+    // a read that started before the swap may still be using the old ring (it becomes the spare of the next seek)
+    while (decoding && (reading.load(std::memory_order_acquire) & READING))
+        std::this_thread::yield();
+    seekDone.store(request, std::memory_order_release);
+}
+
+std::size_t MusicTrack::read(sf::Int16* out, std::size_t count, bool wait) {
+    // offline rendering runs the mixer on the game thread, so a seek requested for this block has to land first
+    while (wait && decoding && seekDone.load(std::memory_order_acquire) != seekRequested.load(std::memory_order_acquire))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    Ring& ring = rings[reading.fetch_or(READING, std::memory_order_acquire) & 1];
+    std::size_t read = ring.readCount.load(std::memory_order_relaxed);
+    while (wait && ring.writeCount.load(std::memory_order_acquire) - read < count && decoding)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    count = std::min(ring.writeCount.load(std::memory_order_acquire) - read, count);
+    count -= count % channelCount;
+
+    std::size_t r = read % ring.data.size();
+    std::size_t first = std::min(count, ring.data.size() - r);
+    std::copy(ring.data.begin() + r, ring.data.begin() + r + first, out);
+    std::copy(ring.data.begin(), ring.data.begin() + (count - first), out + first);
+    ring.readCount.store(read + count, std::memory_order_release);
+    reading.fetch_and(~READING, std::memory_order_release);
+    return count;
+}
+
+void MusicTrack::reposition(sf::Time timeOffset) {
+    // position of offset (intro first, then wrapped into loop)
+    sf::Uint64 offset = (sf::Uint64)std::llround(timeOffset.asSeconds() * Mixer::SAMPLE_RATE) * channelCount;
+    sf::Uint64 introLength = intro.end - intro.begin;
+    if (offset < introLength) {
+        if (!introPath.empty() && !introFile)
+            open(introFile, introPath);
+        intro.file = introPath.empty() ? loopFile.get() : introFile.get();
+        inIntro = true;
+        position = intro.begin + offset;
+        intro.file->seek(position);
+    } else {
+        inIntro = false;
+        position = loop.begin + (offset - introLength) % (loop.end - loop.begin);
+        loop.file->seek(position);
     }
-};
\ No newline at end of file
+}
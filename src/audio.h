@@ -0,0 +1,168 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <SFML/Audio.hpp>
+
+#include "./mixer.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+
+// sound effect played through a fixed pool of mixer voices shared by all effects
+class SoundEffect {
+public:
+    static constexpr int MAX_VOICES = Mixer::MAX_VOICES; // global voice limit
+private:
+    // pooled voice bookkeeping (index is the mixer voice, intrusive links are voice indexes, -1 for none)
+    struct Voice {
+        SoundEffect* owner; // null if free
+        int prev, next; // global active list (oldest to newest) or free list (next only)
+        int ownerPrev, ownerNext; // owner's active list (oldest to newest)
+
+        Voice() : owner(nullptr), prev(-1), next(-1), ownerPrev(-1), ownerNext(-1) {}
+    };
+
+    static std::vector<Voice> voices;
+    static int freeHead;
+    static int activeHead;
+    static int activeTail;
+    static int activeCount;
+    static unsigned long long currentTick;
+    static std::vector<SoundEffect*> effects;
+
+    Mixer::Sample sample;
+    int maxVoices; // voice limit of this effect
+    int priority; // higher priority effects steal voices from lower ones
+    int head, tail, count; // own active voices
+    unsigned long long lastPlayTick;
+
+    static void initPool();
+    static int acquire(SoundEffect& requester);
+    static bool release(int v);
+    static void unlink(int v);
+public:
+    SoundEffect(std::string path, int maxVoices = 8, int priority = 0);
+    ~SoundEffect();
+
+    // voices point back at their effect
+    SoundEffect(const SoundEffect&) = delete;
+    SoundEffect& operator=(const SoundEffect&) = delete;
+
+    // play on a free voice (stealing the oldest voice of equal or lower priority if full)
+    // returns false if dropped (already played this tick, no voice available or mixer queue full)
+    bool play();
+
+    // stop all voices of this effect
+    void stop();
+
+    int activeVoices() const {
+        return count;
+    }
+
+    static int totalActiveVoices() {
+        return activeCount;
+    }
+
+    // advance a tick (releases finished voices)
+    static void tick();
+};
+
+// music playing an intro once then looping a section forever
+// (decoded ahead into a ring buffer on its own thread, so the seam is sample accurate and independent of the game loop)
+class MusicTrack {
+private:
+    // span of a file in interleaved sample offsets (as used by sf::InputSoundFile::seek)
+    struct Section {
+        sf::InputSoundFile* file;
+        sf::Uint64 begin;
+        sf::Uint64 end;
+    };
+
+    std::string introPath; // empty if intro is part of loop file
+    std::unique_ptr<sf::InputSoundFile> introFile; // closed once the intro is decoded
+    std::unique_ptr<sf::InputSoundFile> loopFile;
+    Section intro;
+    Section loop;
+
+    // decoder state (only touched by decoder thread while it runs)
+    bool inIntro;
+    sf::Uint64 position; // in current section's file
+
+    // ring buffer (single producer: decoder thread, single consumer: mixing thread)
+    struct Ring {
+        std::vector<sf::Int16> data;
+        std::atomic<std::size_t> readCount;
+        std::atomic<std::size_t> writeCount;
+    };
+
+    // two rings so a seek never stops the mixer: the decoder fills the one not being read from the new position, then
+    // swaps it in (the mixer only ever picks the ring to read, it never waits, seeks or touches files)
+    static constexpr unsigned int READING = 2; // flag in reading: the mixer is inside read()
+    Ring rings[2];
+    std::atomic<unsigned int> reading; // ring the mixer reads (bit 0) and READING
+    std::size_t decodeSize; // samples decoded at once
+    unsigned int channelCount;
+
+    // seek requests (game thread to decoder thread, the latest request wins)
+    std::atomic<long long> seekOffset; // microseconds
+    std::atomic<unsigned int> seekRequested;
+    std::atomic<unsigned int> seekDone;
+
+    std::thread decoder;
+    std::atomic<bool> decoding;
+
+    void open(std::unique_ptr<sf::InputSoundFile>& file, const std::string& path);
+    void init();
+    void stopDecoder();
+    void decode();
+
+    // decode a chunk into ring (false if it's full)
+    bool decodeInto(Ring& ring);
+
+    // move the decoder to offset (decoder thread once it runs)
+    void reposition(sf::Time offset);
+
+    // serve a seek request: fill the spare ring from the new position and swap it in (decoder thread)
+    void seekDecoder(unsigned int request);
+public:
+    // intro file played once then loop file repeated
+    MusicTrack(std::string startPath, std::string loopPath);
+
+    // single file played up to loopEnd then looped from loopBegin (interleaved sample offsets)
+    MusicTrack(std::string path, sf::Uint64 loopBegin, sf::Uint64 loopEnd);
+
+    ~MusicTrack();
+
+    // add to mix (resumes where it left off, false if the mixer's command queue is full)
+    bool play() {
+        return Mixer::playMusic(*this);
+    }
+
+    // remove from mix
+    bool pause() {
+        return Mixer::stopMusic(*this);
+    }
+
+    // remove from mix and rewind (waits for room in the mixer's command queue)
+    void stop() {
+        while (!Mixer::stopMusic(*this)) Mixer::flush();
+        seek(sf::Time::Zero);
+    }
+
+    // move playback to offset (offsets past the intro wrap around the loop)
+    // done by the decoder thread, the mixer keeps playing the old position until the new one is decoded
+    void seek(sf::Time offset);
+
+    // read decoded samples (called by the mixer, returns a multiple of channel count)
+    // wait is for offline rendering: pending seeks land first and the decoder is waited for until count is available
+    std::size_t read(sf::Int16* out, std::size_t count, bool wait);
+
+    unsigned int getChannelCount() const {
+        return channelCount;
+    }
+};
+
+#endif
@@ -0,0 +1,827 @@
+#include <SFML/Graphics.hpp>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <functional>
+#include <algorithm>
+
+#include "./input.h"
+#include "./scenegraph.h"
+#include "./bullets.h"
+#include "./bulletscript.h"
+#include "./bullettypes.h"
+#include "./lasers.h"
+#include "./bulletquery.h"
+#include "./alloctracker.h"
+#include "./snapshot.h"
+#include "./rng.h"
+#include "./pool.h"
+#include "./quality.h"
+#include "./timeline.h"
+
+// microbenchmarks of engine hot paths
+// usage: CMakeSFMLBench [--out results.json] [--baseline baseline.json] [--threshold 0.1] [--filter text] [--min-time ms]
+// exits with 1 if any correctness check failed or any benchmark got slower than its baseline by more than the threshold
+// (fraction)
+
+class Bench {
+public:
+    struct Result {
+        std::string name;
+        double nsPerOp;
+        long long ops; // per measured batch
+        double allocsPerOp;
+    };
+private:
+    static const int BATCHES = 5; // median is reported
+
+    double minTime; // seconds per benchmark
+    std::string filter;
+    std::vector<Result> results;
+public:
+    Bench(double minTime, std::string filter) : minTime(minTime), filter(filter) {}
+
+    bool enabled(const std::string& name) {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    }
+
+    // body runs the measured operation ops times
+    void run(const std::string& name, std::function<void(long long)> body) {
+        if (!enabled(name)) return;
+        typedef std::chrono::steady_clock Clock;
+
+        // grow batch until it takes a fair share of the time budget (also warms up)
+        long long ops = 1;
+        while (true) {
+            Clock::time_point start = Clock::now();
+            body(ops);
+            double t = std::chrono::duration<double>(Clock::now() - start).count();
+            if (t >= minTime / BATCHES || ops >= (1LL << 40)) break;
+            ops = t <= 0 ? ops * 16 : std::max(ops * 2, std::min(ops * 16, (long long)(ops * minTime / BATCHES / t * 1.2)));
+        }
+
+        double times[BATCHES];
+#if ALLOC_TRACKER
+        unsigned long long allocsBefore = AllocTracker::thread().allocations;
+#endif
+        for (int i = 0; i < BATCHES; ++i) {
+            Clock::time_point start = Clock::now();
+            body(ops);
+            times[i] = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ops;
+        }
+        std::sort(times, times + BATCHES);
+        Result r = { name, times[BATCHES / 2], ops, 0 };
+#if ALLOC_TRACKER
+        r.allocsPerOp = (double)(AllocTracker::thread().allocations - allocsBefore) / (ops * BATCHES);
+#endif
+        results.push_back(r);
+        std::printf("%-40s %14.1f ns/op %10.2f allocs/op\n", name.c_str(), r.nsPerOp, r.allocsPerOp);
+    }
+
+    const std::vector<Result>& getResults() {
+        return results;
+    }
+
+    bool write(const std::string& path) {
+        std::ofstream out(path);
+        out << "{\n  \"benchmarks\": [\n";
+        char line[256];
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            std::snprintf(line, sizeof(line), "    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"ops\": %lld, \"allocs_per_op\": %.3f}%s\n",
+                r.name.c_str(), r.nsPerOp, r.ops, r.allocsPerOp, i + 1 < results.size() ? "," : "");
+            out << line;
+        }
+        out << "  ]\n}\n";
+        return (bool)out;
+    }
+
+    // read name and ns_per_op of every entry of a file written by write()
+    static std::vector<Result> read(const std::string& path) {
+        std::vector<Result> baseline;
+        std::ifstream in(path);
+        if (!in) return baseline;
+        std::stringstream ss;
+        ss << in.rdbuf();
+        std::string s = ss.str();
+        const std::string NAME = "\"name\": \"", NS = "\"ns_per_op\": ";
+        for (std::size_t p = s.find(NAME); p != std::string::npos; p = s.find(NAME, p)) {
+            p += NAME.size();
+            std::size_t end = s.find('"', p);
+            std::size_t ns = s.find(NS, end);
+            if (end == std::string::npos || ns == std::string::npos) break;
+            baseline.push_back({ s.substr(p, end - p), std::strtod(s.c_str() + ns + NS.size(), nullptr), 0, 0 });
+        }
+        return baseline;
+    }
+
+    // print comparison, returns number of regressions
+    int compare(const std::vector<Result>& baseline, double threshold) {
+        int regressions = 0;
+        std::printf("\n%-40s %14s %14s %9s\n", "benchmark", "ns/op", "baseline", "change");
+        for (const Result& r : results) {
+            auto it = std::find_if(baseline.begin(), baseline.end(), [&r](const Result& b) { return b.name == r.name; });
+            if (it == baseline.end() || it->nsPerOp <= 0) {
+                std::printf("%-40s %14.1f %14s\n", r.name.c_str(), r.nsPerOp, "-");
+                continue;
+            }
+            double change = r.nsPerOp / it->nsPerOp - 1;
+            bool regressed = change > threshold;
+            regressions += regressed;
+            std::printf("%-40s %14.1f %14.1f %+8.1f%%%s\n", r.name.c_str(), r.nsPerOp, it->nsPerOp, change * 100, regressed ? "  REGRESSION" : "");
+        }
+        return regressions;
+    }
+};
+
+// remove every bullet (killed bullets are removed after their death animation)
+static void clearBullets() {
+    for (std::shared_ptr<Bullet>& b : Bullet::bullets)
+        b->kill();
+    while (!Bullet::bullets.empty())
+        Bullet::moveTick(0);
+}
+
+static std::shared_ptr<BulletScript> neverEnding() {
+    return BSF::thread({ BSF::accel(-0.1f, 3.f, false), BSF::wait(UINT_MAX) });
+}
+
+static void benchBullets(Bench& bench) {
+    Player::pos = { 1e6f, 1e6f }; // no collisions
+
+    for (int count : { 100, 1000, 10000 }) {
+        std::string name = "Bullet::moveTick/" + std::to_string(count);
+        if (!bench.enabled(name)) continue;
+        for (int i = 0; i < count; ++i)
+            Bullet::create(Bullet::Type::orb, sf::Color::Red, 15, 0, 0, i * 0.001f, 1.f, neverEnding());
+        int tick = 0;
+        bench.run(name, [&tick](long long ops) {
+            for (long long i = 0; i < ops; ++i)
+                Bullet::moveTick(tick++);
+            });
+        clearBullets();
+    }
+
+    // every type in equal parts (one kernel per batch)
+    if (bench.enabled("Bullet::moveTick/1000-mixed")) {
+        for (int i = 0; i < 1000; ++i)
+            Bullet::create((Bullet::Type)(i % Bullet::TYPE_COUNT), sf::Color::Red, 15, 0, 0, i * 0.001f, 1.f, neverEnding());
+        int tick = 0;
+        bench.run("Bullet::moveTick/1000-mixed", [&tick](long long ops) {
+            for (long long i = 0; i < ops; ++i)
+                Bullet::moveTick(tick++);
+            });
+        clearBullets();
+    }
+
+    if (bench.enabled("Bullet::tick")) {
+        std::shared_ptr<Bullet> b = Bullet::create(Bullet::Type::orb, sf::Color::Red, 15, 0, 0, 0, 1.f, neverEnding());
+        bench.run("Bullet::tick", [&b](long long ops) {
+            for (long long i = 0; i < ops; ++i) {
+                b->tick();
+                b->x = b->y = 0;
+            }
+            });
+        clearBullets();
+    }
+
+    // create/clone/destroy churn at a steady population (pools and frame arena, like the spawner in main)
+    if (bench.enabled("Bullet::spawnTick/2")) {
+        int tick = 0;
+        bench.run("Bullet::spawnTick/2", [&tick](long long ops) {
+            for (long long i = 0; i < ops; ++i) {
+                {
+                    BSF::FrameScope frameScripts;
+                    std::shared_ptr<BulletScript> bs = BSF::thread({ BSF::wait(30), BSF::kill() });
+                    for (int j = 0; j < 2; ++j)
+                        Bullet::create(Bullet::Type::orb, sf::Color::Red, 15, 0, 0, j * 3.f, 1.f, bs);
+                }
+                Bullet::moveTick(tick++);
+                FrameArena::frame.reset();
+            }
+            });
+        clearBullets();
+    }
+
+    // draw path of the bullet layers (renderer only counts, so this is traversal and draw submission)
+    if (bench.enabled("SceneGraph::drawTick/bullets-1000")) {
+        RecordingRenderer renderer({ 1280, 960 });
+        SceneGraph sceneGraph(renderer);
+        sceneGraph.root->addChild(Bullet::rootNode);
+        Bullet::rootNode->tf.setPosition(640, 480);
+        for (int i = 0; i < 1000; ++i)
+            Bullet::create(Bullet::Type::orb, sf::Color::Red, 15, (i % 40) * 32.f - 640, (i / 40) * 38.f - 480, 0, 0, neverEnding());
+        Bullet::moveTick(0);
+        bench.run("SceneGraph::drawTick/bullets-1000", [&sceneGraph](long long ops) {
+            for (long long i = 0; i < ops; ++i)
+                sceneGraph.drawTick((int)i);
+            });
+        std::printf("%-40s %d draw calls, %lld vertices, %d state changes per frame\n", "", renderer.getStats().drawCalls, renderer.getStats().vertices, renderer.getStats().stateChanges);
+        clearBullets();
+    }
+}
+
+// bulk selection and a whole screen clear (kill, then tick until the bullets are removed)
+static void benchQueries(Bench& bench) {
+    Player::pos = { 1e6f, 1e6f };
+    const int COUNT = 10000;
+    for (int i = 0; i < COUNT; ++i)
+        Bullet::create((Bullet::Type)(i % Bullet::TYPE_COUNT), sf::Color::Red, 15, (i % 100) * 12.f - 600, (i / 100) * 9.f - 450, 0, 0, neverEnding());
+    Bullet::moveTick(0);
+
+    if (bench.enabled("BulletQuery::inCircle/10000")) {
+        bench.run("BulletQuery::inCircle/10000", [](long long ops) {
+            for (long long i = 0; i < ops; ++i) {
+                BulletQuery().inCircle(0, 0, 300).size();
+                FrameArena::frame.reset();
+            }
+            });
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    std::size_t killed = BulletQuery().kill();
+    FrameArena::frame.reset();
+    double killTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    double worstTick = 0;
+    int ticks = 0;
+    while (!Bullet::bullets.empty()) {
+        Clock::time_point tickStart = Clock::now();
+        Bullet::moveTick(++ticks);
+        worstTick = std::max(worstTick, std::chrono::duration<double, std::milli>(Clock::now() - tickStart).count());
+    }
+    std::printf("%-40s %zu killed in %.2f ms, removed over %d ticks (worst %.2f ms)\n", "screen clear/10000", killed, killTime, ticks, worstTick);
+}
+
+// a laser should cost about as much as a bullet (compare with Bullet::tick)
+static void benchLasers(Bench& bench) {
+    Player::pos = { 1e6f, 1e6f };
+
+    if (bench.enabled("StraightLaser::tick")) {
+        std::shared_ptr<StraightLaser> laser = StraightLaser::create(sf::Color::Red, 0, 0, 0, 600, 30, 0, INT_MAX / 2, 0, 0.01f);
+        bench.run("StraightLaser::tick", [&laser](long long ops) {
+            for (long long i = 0; i < ops; ++i)
+                laser->tick();
+            });
+        Lasers::clear();
+    }
+
+    // head circling in place with a 64 point trail
+    if (bench.enabled("CurvyLaser::tick/64")) {
+        std::shared_ptr<CurvyLaser> laser = CurvyLaser::create(sf::Color::Red, 0, 0, 0, 3, 0.05f, 20, 64, INT_MAX);
+        bench.run("CurvyLaser::tick/64", [&laser](long long ops) {
+            for (long long i = 0; i < ops; ++i)
+                laser->tick();
+            });
+        Lasers::clear();
+    }
+
+    if (bench.enabled("SceneGraph::drawTick/lasers-100")) {
+        RecordingRenderer renderer({ 1280, 960 });
+        SceneGraph sceneGraph(renderer);
+        sceneGraph.root->addChild(Lasers::rootNode);
+        Lasers::rootNode->tf.setPosition(640, 480);
+        for (int i = 0; i < 50; ++i) {
+            StraightLaser::create(sf::Color::Red, 0, 0, i * 0.125f, 600, 30, 0, INT_MAX / 2);
+            CurvyLaser::create(sf::Color::Blue, (i % 10) * 100.f - 450, (i / 10) * 150.f - 300, i, 3, 0.05f, 20, 64, INT_MAX);
+        }
+        for (int i = 0; i < 64; ++i)
+            Lasers::moveTick();
+        bench.run("SceneGraph::drawTick/lasers-100", [&sceneGraph](long long ops) {
+            for (long long i = 0; i < ops; ++i)
+                sceneGraph.drawTick((int)i);
+            });
+        std::printf("%-40s %d draw calls, %lld vertices, %d state changes per frame\n", "", renderer.getStats().drawCalls, renderer.getStats().vertices, renderer.getStats().stateChanges);
+        sceneGraph.root->removeChild(Lasers::rootNode);
+        Lasers::clear();
+    }
+}
+
+static void benchTimeline(Bench& bench) {
+    // a stage of 10000 events spread over 10 minutes, ticks between them only look at the next one
+    Timeline timeline;
+    int runs = 0;
+    for (int i = 0; i < 10000; ++i)
+        timeline.at(i * 3 + 1, [&runs](int) { runs++; });
+    bench.run("Timeline::tick/10000-idle", [&](long long ops) {
+        for (long long i = 0; i < ops; ++i)
+            timeline.tick(0);
+        });
+
+    // 1000 repeating events due every tick
+    timeline.clear();
+    for (int i = 0; i < 1000; ++i)
+        timeline.every(0, 1, Timeline::FOREVER, [&runs](int) { runs++; });
+    int tick = 0;
+    bench.run("Timeline::tick/1000-due", [&](long long ops) {
+        for (long long i = 0; i < ops; ++i)
+            timeline.tick(tick++);
+        });
+}
+
+static void benchScripts(Bench& bench) {
+    Player::pos = { 1e6f, 1e6f };
+    Bullet b(Bullet::Type::orb, sf::Color::Red, 15, 0, 0, 0, 1.f, nullptr);
+
+    // scripts keep being applied after they finish (measures the apply itself)
+    std::vector<std::pair<std::string, std::function<std::shared_ptr<BulletScript>()>>> scripts = {
+        { "move", [] { return BSF::move(1, 0); } },
+        { "goTo", [] { return BSF::goTo(0, 0); } },
+        { "turn", [] { return BSF::turn(0.01f); } },
+        { "dir", [] { return BSF::dir(1); } },
+        { "color", [] { return BSF::color(sf::Color::Blue); } },
+        { "changeSpeed", [] { return BSF::changeSpeed(0.f); } },
+        { "setSpeed", [] { return BSF::setSpeed(1); } },
+        { "accel", [] { return BSF::accel(0.1f, 3.f, true); } },
+        { "enableRotate", [] { return BSF::enableRotate(true); } },
+        { "disableRotate", [] { return BSF::disableRotate(true); } },
+        { "wait", [] { return BSF::wait(UINT_MAX); } },
+        { "waitUntilInside", [] { return BSF::waitUntilInside(10); } },
+        { "waitUntilOffscreen", [] { return BSF::waitUntilOffscreen(); } },
+        { "kill", [] { return BSF::kill(); } },
+        { "script", [] { return BSF::script([](Bullet& b) { return b.time > 0; }); } },
+        { "thread/1", [] { return BSF::thread({ BSF::wait(UINT_MAX) }); } },
+        { "thread/8", [] { return BSF::thread({ BSF::turn(0), BSF::turn(0), BSF::turn(0), BSF::turn(0), BSF::turn(0), BSF::turn(0), BSF::turn(0), BSF::wait(UINT_MAX) }); } },
+        { "threadLoop/1", [] { return BSF::threadLoop({ BSF::wait(UINT_MAX) }); } },
+        { "bundle/1", [] { return BSF::bundle({ BSF::turn(0) }); } },
+        { "bundle/8", [] { return BSF::bundle({ BSF::turn(0), BSF::turn(0), BSF::turn(0), BSF::turn(0), BSF::turn(0), BSF::turn(0), BSF::turn(0), BSF::turn(0) }); } },
+    };
+    for (auto& entry : scripts) {
+        std::string name = "BulletScript::apply/" + entry.first;
+        if (!bench.enabled(name)) continue;
+        std::shared_ptr<BulletScript> script = entry.second();
+        bench.run(name, [&script, &b](long long ops) {
+            for (long long i = 0; i < ops; ++i)
+                script->apply(b);
+            });
+    }
+
+    if (bench.enabled("BulletScript::clone/thread")) {
+        std::shared_ptr<BulletScript> script = neverEnding();
+        bench.run("BulletScript::clone/thread", [&script](long long ops) {
+            for (long long i = 0; i < ops; ++i)
+                script->clone();
+            });
+    }
+}
+
+static void benchNodes(Bench& bench) {
+    RecordingRenderer target({ 1280, 960 });
+
+    // 10 groups of 100 leaves (drawn leaves do no rendering, so only traversal is measured)
+    std::shared_ptr<Node> root = Node::create();
+    std::vector<std::shared_ptr<DrawableNode>> leaves;
+    for (int g = 0; g < 10; ++g) {
+        std::shared_ptr<Node> group = Node::create();
+        root->addChild(group);
+        for (int i = 0; i < 100; ++i) {
+            leaves.push_back(DrawableNode::create([](Renderer&, const sf::Transform&, int) {}));
+            leaves.back()->tf.setPosition(i * 10.f, g * 10.f);
+            group->addChild(leaves.back());
+        }
+    }
+
+    Node::cullEnabled = false;
+    bench.run("Node::draw/1000", [&](long long ops) {
+        for (long long i = 0; i < ops; ++i)
+            root->draw(target, sf::Transform::Identity, (int)i);
+        });
+
+    // everything culled
+    for (std::shared_ptr<DrawableNode>& leaf : leaves)
+        leaf->setBounds(sf::FloatRect(-1, -1, 2, 2));
+    Node::cullEnabled = true;
+    Node::cullRect = sf::FloatRect(-1000, -1000, 10, 10);
+    bench.run("Node::draw/1000-culled", [&](long long ops) {
+        for (long long i = 0; i < ops; ++i)
+            root->draw(target, sf::Transform::Identity, (int)i);
+        });
+    Node::cullEnabled = false;
+
+    // same tree with circle leaves (statically dispatched, one shape submitted each)
+    if (bench.enabled("Node::draw/1000-circles")) {
+        sf::CircleShape circle(4.f);
+        std::shared_ptr<Node> circleRoot = Node::create();
+        for (int g = 0; g < 10; ++g) {
+            std::shared_ptr<Node> group = Node::create();
+            circleRoot->addChild(group);
+            for (int i = 0; i < 100; ++i) {
+                std::shared_ptr<CircleNode> leaf = CircleNode::create();
+                leaf->setCircles(&circle, 1);
+                leaf->tf.setPosition(i * 10.f, g * 10.f);
+                group->addChild(leaf);
+            }
+        }
+        bench.run("Node::draw/1000-circles", [&](long long ops) {
+            for (long long i = 0; i < ops; ++i)
+                circleRoot->draw(target, sf::Transform::Identity, (int)i);
+            });
+    }
+
+    for (int count : { 10, 100, 1000 }) {
+        std::vector<std::shared_ptr<Node>> children;
+        for (int i = 0; i < count; ++i)
+            children.push_back(Node::create());
+        std::shared_ptr<Node> parent = Node::create();
+        bench.run("Node::addChild+removeChild/" + std::to_string(count), [&](long long ops) {
+            for (long long i = 0; i < ops; ++i) {
+                for (std::shared_ptr<Node>& c : children)
+                    parent->addChild(c);
+                for (std::shared_ptr<Node>& c : children)
+                    parent->removeChild(c);
+            }
+            });
+    }
+}
+
+static void benchInput(Bench& bench) {
+    const Input::Action up = Input::mapInput(sf::Keyboard::W, "up");
+    Input::mapInput(sf::Keyboard::A, "left");
+    Input::mapInput(sf::Keyboard::S, "down");
+    Input::mapInput(sf::Keyboard::D, "right");
+
+    volatile bool sink = false;
+    bench.run("Input::isPressed(action)", [&](long long ops) {
+        for (long long i = 0; i < ops; ++i)
+            sink = Input::isPressed(up);
+        });
+    bench.run("Input::isPressed(string)", [&](long long ops) {
+        for (long long i = 0; i < ops; ++i)
+            sink = Input::isPressed("up");
+        });
+    bench.run("Input::justPressed(action)", [&](long long ops) {
+        for (long long i = 0; i < ops; ++i)
+            sink = Input::justPressed(up);
+        });
+    bench.run("Input::inputTick/4-events", [&](long long ops) {
+        Input::Clock::time_point t = Input::Clock::now();
+        for (long long i = 0; i < ops; ++i) {
+            bool pressed = (i & 1) == 0;
+            Input::inputEvent(sf::Keyboard::W, pressed, t);
+            Input::inputEvent(sf::Keyboard::A, pressed, t);
+            Input::inputEvent(sf::Keyboard::S, pressed, t);
+            Input::inputEvent(sf::Keyboard::D, pressed, t);
+            Input::inputTick();
+        }
+        });
+    bench.run("Input::inputTick/idle", [&](long long ops) {
+        for (long long i = 0; i < ops; ++i)
+            Input::inputTick();
+        });
+}
+
+// busy scene: a ring of bullets every tick, each with waits, a bundle of turns and a death after a while (and every
+// orb turned to rice now and then)
+static void snapshotSceneTick(int tick) {
+    for (int i = 0; i < 16; ++i) {
+        std::shared_ptr<BulletScript> script = BSF::thread({
+            BSF::accel(0.05f, 4.f, false),
+            BSF::wait(10 + i),
+            BSF::bundle({ BSF::turn(0.01f), BSF::changeSpeed(0.01f) }),
+            BSF::wait(40),
+            BSF::kill()
+            });
+        Bullet::create(Bullet::Type::orb, sf::Color(tick % 256, i * 16, 255), 15, 0, 0, Rng::game.uniform(0, 6.2831853f), 1.f, script);
+    }
+    if (tick % 20 == 0) {
+        StraightLaser::create(sf::Color::Red, 0, 0, Rng::game.uniform(0, 6.2831853f), 600, 30, 10, 30, 20.f, 0.01f);
+        CurvyLaser::create(sf::Color::Blue, 0, 0, Rng::game.uniform(0, 6.2831853f), 4.f, 0.02f, 20, 48, 90);
+    }
+    if (tick % 60 == 30) BulletQuery().ofType(Bullet::orb).convert(Bullet::rice);
+    Bullet::moveTick(tick);
+    Lasers::moveTick();
+}
+
+// busy scene after two seconds
+static int snapshotScene() {
+    Player::pos = { 1e6f, 1e6f };
+    Rng::game.reseed(1);
+    int tick = 0;
+    while (tick < 120)
+        snapshotSceneTick(tick++);
+    return tick;
+}
+
+// capture and restore cost of the busy scene
+static void benchSnapshot(Bench& bench) {
+    snapshotScene();
+    std::string name = "WorldSnapshot::capture/" + std::to_string(Bullet::bullets.size());
+    WorldSnapshot snapshot;
+    bench.run(name, [&snapshot](long long ops) {
+        for (long long i = 0; i < ops; ++i)
+            snapshot.capture(0);
+        });
+    name = "WorldSnapshot::restore/" + std::to_string(Bullet::bullets.size());
+    bench.run(name, [&snapshot](long long ops) {
+        for (long long i = 0; i < ops; ++i)
+            snapshot.restore();
+        });
+
+    clearBullets();
+    Lasers::clear();
+}
+
+// restore must give back the captured bytes, and simulating on from it must match the first run in state and in the
+// draws of its first tick (bullets that were converted since the capture must draw as their restored type)
+static bool checkSnapshot() {
+    int tick = snapshotScene();
+    RecordingRenderer renderer({ 1280, 960 }, true);
+    SceneGraph sceneGraph(renderer);
+    sceneGraph.root->addChild(Bullet::rootNode);
+    auto simulate = [&](std::ostringstream& draws) {
+        for (int i = 0; i < 60; ++i) {
+            snapshotSceneTick(tick + i);
+            if (i == 0) {
+                sceneGraph.drawTick(tick);
+                renderer.dump(draws);
+            }
+        }
+    };
+    WorldSnapshot start, end, check;
+    std::ostringstream draws, replayedDraws;
+    start.capture(tick);
+    simulate(draws);
+    end.capture(tick + 60);
+    int restored = start.restore();
+    check.capture(restored);
+    bool ok = restored == tick && check.bytes() == start.bytes();
+    simulate(replayedDraws);
+    check.capture(tick + 60);
+    ok = ok && check.bytes() == end.bytes() && replayedDraws.str() == draws.str();
+    sceneGraph.root->removeChild(Bullet::rootNode);
+    return ok;
+}
+
+// collision kernels against points just inside and outside of each hitbox (bullet radius 10)
+template <Bullet::Type T>
+static bool hits(float dx, float dy, float dir) {
+    return BulletTraits<T>::Hitbox::hits(dx, dy, 10, std::cos(dir), std::sin(dir));
+}
+
+static bool checkHitboxes() {
+    const float QUARTER = 1.5707964f;
+    bool ok = hits<Bullet::orb>(3, 0, 0) && !hits<Bullet::orb>(4, 0, 0) && hits<Bullet::orb>(0, -3, 1)
+        && hits<Bullet::rice>(4.9f, 0, 0) && !hits<Bullet::rice>(5.1f, 0, 0) && hits<Bullet::rice>(0, 2.4f, 0) && !hits<Bullet::rice>(0, 2.6f, 0)
+        && hits<Bullet::rice>(0, 4.9f, QUARTER) && !hits<Bullet::rice>(4.9f, 0, QUARTER)
+        && hits<Bullet::kunai>(6.9f, 0, 0) && !hits<Bullet::kunai>(7.1f, 0, 0) && hits<Bullet::kunai>(-3, 1.9f, 0) && !hits<Bullet::kunai>(3, 2.1f, 0)
+        && hits<Bullet::star>(0, 3.9f, 0) && !hits<Bullet::star>(4.1f, 0, 0);
+    return ok;
+}
+
+// lasers only hit while fully grown, along their whole length, and curvy ones along the path the head took
+static bool checkLasers() {
+    long long before = Lasers::hitTicks;
+    std::shared_ptr<StraightLaser> straight = StraightLaser::create(sf::Color::Red, 0, 0, 0, 400, 20, 10, 20);
+    Player::pos = { 300, 5 };
+    bool ok = true;
+    for (int i = 0; i < 10 + 8; ++i) {
+        straight->tick();
+        ok = ok && Lasers::hitTicks == before;
+    }
+    straight->tick();
+    ok = ok && Lasers::hitTicks == before + 1;
+    Player::pos = { 300, 7 };
+    straight->tick();
+    ok = ok && Lasers::hitTicks == before + 1;
+
+    // quarter circle of radius 100 from (0, 0) ending at (100, 100)
+    std::shared_ptr<CurvyLaser> curvy = CurvyLaser::create(sf::Color::Red, 0, 0, -0.0314159f * 0.5f, 3.14159f, 0.0314159f, 20, 64, 50);
+    Player::pos = { 1e6f, 1e6f };
+    for (int i = 0; i < 50; ++i)
+        curvy->tick();
+    before = Lasers::hitTicks;
+    Player::pos = { 70.7f, 29.3f };
+    curvy->tick();
+    ok = ok && Lasers::hitTicks == before + 1;
+    Player::pos = { 50, 50 };
+    curvy->tick();
+    ok = ok && Lasers::hitTicks == before + 1;
+
+    return ok;
+}
+
+// filters combine, conversions move bullets between batches (seen by queries in the same tick), parallel selections
+// match serial ones
+static bool checkQueries() {
+    Player::pos = { 1e6f, 1e6f };
+    for (int i = 0; i < 20000; ++i) {
+        std::shared_ptr<Bullet> b = Bullet::create(i % 2 ? Bullet::orb : Bullet::rice, sf::Color::Red, 15, (float)(i % 200), 0, 0, 0, BSF::wait(UINT_MAX));
+        b->tag = i % 3;
+    }
+    Bullet::moveTick(0);
+    bool ok = BulletQuery().tagged(1).ofType(Bullet::orb).inRect({ 0, -1, 100, 2 }).size() == 1667
+        && BulletQuery().parallel().tagged(1).getBullets() == BulletQuery().tagged(1).getBullets();
+    ok = ok && BulletQuery(Bullet::orb).withColor(sf::Color::Red).convert(Bullet::star) == 10000;
+    ok = ok && BulletQuery(Bullet::orb).size() == 0 && BulletQuery(Bullet::star).size() == 10000;
+    Bullet::moveTick(1);
+    ok = ok && Bullet::batches[Bullet::orb].empty() && Bullet::batches[Bullet::star].size() == 10000;
+    ok = ok && BulletQuery(Bullet::star).inCircle(0, 0, 10).kill() == 500;
+    for (int tick = 2; tick < 20; ++tick)
+        Bullet::moveTick(tick);
+    ok = ok && Bullet::bullets.size() == 20000 - 500 && Bullet::frontRootNode->getChildren().size() == Bullet::bullets.size();
+    return ok;
+}
+
+// tiers drop under sustained load, hold inside the hysteresis band and come back with headroom
+static bool checkQuality() {
+    QualityGovernor governor(16.f);
+    int changes = 0;
+    for (int i = 0; i < 60; ++i)
+        changes += governor.record(10, 10);
+    bool ok = changes == 1 && governor.getTier() == QualityGovernor::medium;
+    for (int i = 0; i < 600; ++i)
+        governor.record(10, 10);
+    ok = ok && governor.getTier() == QualityGovernor::minimal;
+    changes = governor.getChanges();
+    for (int i = 0; i < 1000; ++i)
+        governor.record(6, 6);
+    ok = ok && governor.getChanges() == changes;
+    for (int i = 0; i < 1000; ++i)
+        governor.record(3, 3);
+    ok = ok && governor.getTier() == QualityGovernor::high;
+    governor.setTier(QualityGovernor::low);
+    for (int i = 0; i < 100; ++i)
+        ok = ok && !governor.record(50, 50);
+
+    Bullet::setDetail(false, false, false);
+    ok = ok && Bullet::rootNode->getChildren().size() == 1 && Bullet::rootNode->getChildren().front() == Bullet::frontRootNode;
+    Bullet::setDetail(true, true, true);
+    ok = ok && Bullet::rootNode->getChildren().size() == 2 && Bullet::rootNode->getChildren().front() == Bullet::backRootNode;
+    return ok;
+}
+
+// a reduced resolution scene draws into the texture, the output gets the stretched texture then the hud
+static bool checkOffscreen() {
+    RecordingRenderer output({ 1280, 960 }, true);
+    OffscreenRenderer offscreen(output);
+    SceneGraph sceneGraph(output);
+    bool ok = offscreen.create({ 640, 480 }, false);
+    sceneGraph.offscreen = &offscreen;
+    sf::CircleShape circle(4.f);
+    std::shared_ptr<CircleNode> sceneLeaf = CircleNode::create();
+    sceneLeaf->setCircles(&circle, 1);
+    sceneGraph.root->addChild(sceneLeaf);
+    std::shared_ptr<CircleNode> hudLeaf = CircleNode::create();
+    hudLeaf->setCircles(&circle, 1);
+    sceneGraph.hud->addChild(hudLeaf);
+    sceneGraph.drawTick(0);
+
+    const std::vector<RecordingRenderer::Command>& commands = output.getCommands();
+    ok = ok && offscreen.getStats().drawCalls == 1 && commands.size() == 2
+        && commands[0].kind == RecordingRenderer::Command::sprite && commands[1].kind == RecordingRenderer::Command::shape
+        && commands[0].transform.transformPoint(640, 480) == sf::Vector2f(1280, 960)
+        && sceneGraph.getDrawStats().drawCalls == 3;
+    return ok;
+}
+
+// events run in tick then scheduling order, repeat, cancel and come back the same after a snapshot restore
+static bool checkTimeline() {
+    std::string log;
+    Timeline& timeline = Timeline::stage;
+    timeline.clear();
+    timeline.at(5, [&log](int tick) { log += "a" + std::to_string(tick) + " "; });
+    timeline.every(3, 4, 3, [&log](int tick) { log += "b" + std::to_string(tick) + " "; });
+    timeline.at(5, [&log, &timeline](int tick) {
+        log += "c" + std::to_string(tick) + " ";
+        timeline.after(2, [&log](int tick) { log += "d" + std::to_string(tick) + " "; });
+        });
+    int e = timeline.every(0, 10, Timeline::FOREVER, [&log](int tick) { log += "e" + std::to_string(tick) + " "; });
+    for (int tick = 0; tick < 12; ++tick)
+        timeline.tick(tick);
+    bool ok = log == "e0 b3 a5 c5 b7 d7 e10 b11 " && timeline.size() == 1 && timeline.nextTick() == 20;
+    timeline.cancel(e);
+    timeline.tick(20);
+    ok = ok && log == "e0 b3 a5 c5 b7 d7 e10 b11 " && timeline.size() == 0;
+
+    // restoring drops events scheduled after the capture and puts back the ones that ran since
+    timeline.clear();
+    timeline.every(0, 2, 5, [&log, &timeline](int tick) {
+        log += std::to_string(tick) + " ";
+        timeline.after(1, [&log](int tick) { log += "+ "; });
+        });
+    timeline.tick(0);
+    timeline.tick(1);
+    WorldSnapshot snapshot;
+    snapshot.capture(2);
+    log.clear();
+    for (int tick = 2; tick < 12; ++tick)
+        timeline.tick(tick);
+    std::string first = log;
+    snapshot.restore();
+    log.clear();
+    for (int tick = 2; tick < 12; ++tick)
+        timeline.tick(tick);
+    ok = ok && first == "2 + 4 + 6 + 8 + " && log == first && timeline.size() == 0;
+
+    // a long stage reuses the ids of finished events, so its snapshots stay the same size (compared at the same phase)
+    timeline.clear();
+    timeline.every(0, 1, Timeline::FOREVER, [&timeline](int tick) {
+        timeline.after(5, [](int) {});
+        if (tick % 7 == 0) timeline.every(tick + 1, 2, 3, [](int) {});
+        });
+    std::size_t early = 0;
+    for (int tick = 0; tick <= 99000; ++tick) {
+        timeline.tick(tick);
+        if (tick == 1000) {
+            snapshot.capture(tick);
+            early = snapshot.size();
+        }
+    }
+    snapshot.capture(99000);
+    ok = ok && snapshot.size() == early;
+    return ok;
+}
+
+// correctness checks, run before the benchmarks (selected by --filter like them, prefixed so --filter check/ runs
+// only the checks)
+struct Check {
+    const char* name;
+    bool (*run)();
+};
+
+static const Check CHECKS[] = {
+    { "check/bullet hitboxes", checkHitboxes },
+    { "check/laser collisions", checkLasers },
+    { "check/bullet queries", checkQueries },
+    { "check/quality governor", checkQuality },
+    { "check/offscreen scene", checkOffscreen },
+    { "check/stage timeline", checkTimeline },
+    { "check/WorldSnapshot round trip", checkSnapshot },
+};
+
+// empty world for the next check or benchmark (checks may leave bullets, lasers, events and the player anywhere)
+static void resetWorld() {
+    clearBullets();
+    Lasers::clear();
+    Timeline::stage.clear();
+    FrameArena::frame.reset();
+    Player::pos = { 1e6f, 1e6f };
+}
+
+int main(int argc, char** argv) {
+    std::string outPath, baselinePath, filter;
+    double threshold = 0.1;
+    double minTime = 0.5;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--out") outPath = argv[i + 1];
+        else if (option == "--baseline") baselinePath = argv[i + 1];
+        else if (option == "--threshold") threshold = std::stod(argv[i + 1]);
+        else if (option == "--filter") filter = argv[i + 1];
+        else if (option == "--min-time") minTime = std::stod(argv[i + 1]) / 1000;
+    }
+
+    Bullet::init({ 1280, 960 }, -640, 640, -480, 480);
+    Lasers::init(-640, 640, -480, 480);
+
+    Bench bench(minTime, filter);
+    int failedChecks = 0;
+    for (const Check& check : CHECKS) {
+        if (!bench.enabled(check.name)) continue;
+        bool ok = check.run();
+        resetWorld();
+        std::printf("%-40s %s\n", check.name, ok ? "ok" : "FAILED");
+        failedChecks += !ok;
+    }
+
+    benchBullets(bench);
+    benchLasers(bench);
+    benchQueries(bench);
+    benchTimeline(bench);
+    benchScripts(bench);
+    benchNodes(bench);
+    benchInput(bench);
+    benchSnapshot(bench);
+
+    if (!outPath.empty() && !bench.write(outPath)) {
+        std::cerr << "cannot write results to " << outPath << std::endl;
+        return 1;
+    }
+    if (!baselinePath.empty()) {
+        std::vector<Bench::Result> baseline = Bench::read(baselinePath);
+        if (baseline.empty()) {
+            std::cerr << "cannot read baseline " << baselinePath << std::endl;
+            return 1;
+        }
+        int regressions = bench.compare(baseline, threshold);
+        if (regressions != 0) {
+            std::printf("%d benchmark(s) regressed by more than %.0f%%\n", regressions, threshold * 100);
+            return 1;
+        }
+    }
+    if (failedChecks != 0) {
+        std::cerr << failedChecks << " check(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
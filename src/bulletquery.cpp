@@ -0,0 +1,50 @@
+# include "./bulletquery.h"
+
+const std::size_t BulletQuery::PARALLEL_MIN = 16384;
+
+BulletQuery::BulletQuery() : selection(&FrameArena::frame), threaded(false) {
+    selection.reserve(Bullet::bullets.size());
+    for (const std::shared_ptr<Bullet>& b : Bullet::bullets)
+        if (b->alive && !b->remove) selection.push_back(b.get());
+}
+
+BulletQuery::BulletQuery(Bullet::Type type) : selection(&FrameArena::frame), threaded(false) {
+    // bullets converted earlier in the tick are found under their new type
+    Bullet::updateBatches();
+    selection.reserve(Bullet::batches[type].size());
+    for (Bullet* b : Bullet::batches[type])
+        if (b->alive && !b->remove) selection.push_back(b);
+}
+
+std::size_t BulletQuery::kill() {
+    // sequential, kill runs the death listeners
+    for (Bullet* b : selection)
+        b->kill();
+    return selection.size();
+}
+
+std::size_t BulletQuery::convert(Bullet::Type type) {
+    for (Bullet* b : selection)
+        b->setType(type);
+    return selection.size();
+}
+
+std::size_t BulletQuery::recolor(sf::Color color) {
+    return forEach([color](Bullet& b) {
+        if (b.color == color) return;
+        b.color = color;
+        b.updateTexture = true;
+        });
+}
+
+std::size_t BulletQuery::redirect(float dir) {
+    return forEach([dir](Bullet& b) { b.dir = dir; });
+}
+
+std::size_t BulletQuery::aimAt(float x, float y) {
+    return forEach([x, y](Bullet& b) { b.dir = std::atan2(y - b.y, x - b.x); });
+}
+
+std::size_t BulletQuery::setSpeed(float speed) {
+    return forEach([speed](Bullet& b) { b.speed = speed; });
+}
@@ -0,0 +1,149 @@
+# ifndef BULLETQUERY_H
+# define BULLETQUERY_H
+
+# include "./bullets.h"
+# include "./pool.h"
+
+# include <SFML/Graphics.hpp>
+# include <algorithm>
+# include <cmath>
+# include <memory_resource>
+# include <thread>
+# include <vector>
+
+// bulk operations over the bullet store for game events (bombs, phase transitions, clearing the screen)
+// a query starts from every living bullet (or one type's batch), filters narrow the selection down (all of them have
+// to match) and actions apply to the whole selection in one pass, e.g. BulletQuery().inCircle(x, y, 200).kill()
+// killed bullets leave through the single compaction at the end of Bullet::moveTick, type changes rebatch once
+// the selection is allocated from the frame arena, so a query only lives within the tick it was made in
+class BulletQuery {
+private:
+    static const std::size_t PARALLEL_MIN; // smallest selection split across threads
+    static constexpr int MAX_THREADS = 16;
+
+    std::pmr::vector<Bullet*> selection;
+    bool threaded;
+
+    // run body(chunk, begin, end) over chunks of [0, count), on worker threads if parallel and big enough
+    // (returns the chunk count)
+    template <typename Body>
+    int split(std::size_t count, Body body);
+public:
+    // every living bullet (creation order)
+    BulletQuery();
+
+    // living bullets of one type
+    BulletQuery(Bullet::Type type);
+
+    // split filters and field updates across threads for big selections (the results are the same, predicates and
+    // forEach functions have to be thread safe, death listeners stay on the calling thread)
+    BulletQuery& parallel(bool on = true) {
+        threaded = on;
+        return *this;
+    }
+
+    // keep the selected bullets pred(const Bullet&) is true for (order is kept)
+    template <typename Pred>
+    BulletQuery& where(Pred pred);
+
+    BulletQuery& inRect(sf::FloatRect rect) {
+        return where([rect](const Bullet& b) { return rect.contains(b.x, b.y); });
+    }
+
+    BulletQuery& inCircle(float x, float y, float radius) {
+        return where([x, y, radius](const Bullet& b) { return (b.x - x) * (b.x - x) + (b.y - y) * (b.y - y) <= radius * radius; });
+    }
+
+    BulletQuery& ofType(Bullet::Type type) {
+        return where([type](const Bullet& b) { return b.type == type; });
+    }
+
+    BulletQuery& withColor(sf::Color color) {
+        return where([color](const Bullet& b) { return b.color == color; });
+    }
+
+    // tag set by BSF::tag
+    BulletQuery& tagged(int tag) {
+        return where([tag](const Bullet& b) { return b.tag == tag; });
+    }
+
+    std::size_t size() const {
+        return selection.size();
+    }
+
+    const std::pmr::vector<Bullet*>& getBullets() const {
+        return selection;
+    }
+
+    // actions (return how many bullets they applied to)
+
+    // fn(Bullet&) on every selected bullet
+    template <typename Fn>
+    std::size_t forEach(Fn fn);
+
+    std::size_t kill();
+
+    // change type (geometry follows on the next tick)
+    std::size_t convert(Bullet::Type type);
+
+    std::size_t recolor(sf::Color color);
+
+    // set direction of travel
+    std::size_t redirect(float dir);
+
+    // turn towards a point
+    std::size_t aimAt(float x, float y);
+
+    std::size_t setSpeed(float speed);
+};
+
+template <typename Body>
+int BulletQuery::split(std::size_t count, Body body) {
+    int chunks = 1;
+    if (threaded && count >= PARALLEL_MIN)
+        chunks = std::max(1, std::min(MAX_THREADS, (int)std::thread::hardware_concurrency()));
+    if (chunks == 1) {
+        body(0, 0, count);
+        return 1;
+    }
+    std::vector<std::thread> workers;
+    workers.reserve(chunks - 1);
+    for (int c = 1; c < chunks; ++c)
+        workers.emplace_back(body, c, count * c / chunks, count * (c + 1) / chunks);
+    body(0, 0, count / chunks);
+    for (std::thread& worker : workers)
+        worker.join();
+    return chunks;
+}
+
+template <typename Pred>
+BulletQuery& BulletQuery::where(Pred pred) {
+    // every chunk compacts in place, then the kept ranges are moved together
+    std::size_t begins[MAX_THREADS];
+    std::size_t ends[MAX_THREADS];
+    int chunks = split(selection.size(), [this, &pred, &begins, &ends](int chunk, std::size_t begin, std::size_t end) {
+        std::size_t out = begin;
+        for (std::size_t i = begin; i < end; ++i)
+            if (pred(static_cast<const Bullet&>(*selection[i]))) selection[out++] = selection[i];
+        begins[chunk] = begin;
+        ends[chunk] = out;
+        });
+    std::size_t size = ends[0];
+    for (int c = 1; c < chunks; ++c) {
+        std::move(selection.begin() + begins[c], selection.begin() + ends[c], selection.begin() + size);
+        size += ends[c] - begins[c];
+    }
+    selection.resize(size);
+    return *this;
+}
+
+template <typename Fn>
+std::size_t BulletQuery::forEach(Fn fn) {
+    split(selection.size(), [this, &fn](int, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            fn(*selection[i]);
+        });
+    return selection.size();
+}
+
+# endif
@@ -1,21 +1,35 @@
 # include "./bullets.h"
 # include "./bulletscript.h"
+# include "./bullettypes.h"
 
 # include <algorithm>
 
 sf::Vector2u Bullet::wSize = { 0,0 };
 
-std::shared_ptr<Node> Bullet::rootNode = std::make_shared<Node>();
-std::shared_ptr<Node> Bullet::frontRootNode = std::make_shared<Node>();
-std::shared_ptr<Node> Bullet::backRootNode = std::make_shared<Node>();
+std::shared_ptr<Node> Bullet::rootNode = Node::create();
+std::shared_ptr<Node> Bullet::frontRootNode = Node::create();
+std::shared_ptr<Node> Bullet::backRootNode = Node::create();
 
 std::vector<std::shared_ptr<Bullet>> Bullet::bullets = std::vector<std::shared_ptr<Bullet>>();
+std::vector<Bullet*> Bullet::batches[Bullet::TYPE_COUNT];
+std::vector<Bullet::DeathListener> Bullet::deathListeners;
+int Bullet::nextDeathListener = 0;
+long long Bullet::scriptInstructions = 0;
+long long Bullet::spawned = 0;
+long long Bullet::removed = 0;
+std::size_t Bullet::removals = 0;
+bool Bullet::rebatch = false;
+bool Bullet::outlines = true;
+bool Bullet::deathShrink = true;
+std::pmr::memory_resource* BSF::resource = nullptr;
 # if USE_SHADER
 std::vector<std::shared_ptr<Bullet>> Bullet::deleteQueue = std::vector<std::shared_ptr<Bullet>>();
 # endif
 
 std::shared_ptr<Bullet> Bullet::create(Type type, sf::Color color, float radius, float x, float y, float dir, float speed, std::shared_ptr<BulletScript> script) {
-    Bullet::bullets.push_back(std::make_shared<Bullet>(type, color, radius, x, y, dir, speed, script));
+    Bullet::bullets.push_back(makePooled<Bullet>(type, color, radius, x, y, dir, speed, script));
+    batches[type].push_back(Bullet::bullets.back().get());
+    spawned++;
     return Bullet::bullets.back();
 }
 
@@ -26,9 +40,23 @@ sf::Shader Bullet::bulletBackShader = sf::Shader();
 
 const int Bullet::BULLET_RENDER_RADIUS = 32; // (set to power of 2 if shader on)
 
-const float Bullet::COLLISION_DIST_SQD = 5 * 5;
 const int Bullet::BULLET_DEATH_TIME = 15;
 
+void (Bullet::* const Bullet::TICK_MOTION[Bullet::TYPE_COUNT])() = {
+    &Bullet::tickMotion<Bullet::orb>, &Bullet::tickMotion<Bullet::rice>, &Bullet::tickMotion<Bullet::kunai>, &Bullet::tickMotion<Bullet::star>
+};
+void (Bullet::* const Bullet::UPDATE_NODES[Bullet::TYPE_COUNT])() = {
+    &Bullet::updateNodes<Bullet::orb>, &Bullet::updateNodes<Bullet::rice>, &Bullet::updateNodes<Bullet::kunai>, &Bullet::updateNodes<Bullet::star>
+};
+static const float EXTENT[Bullet::TYPE_COUNT] = {
+    BulletTraits<Bullet::orb>::EXTENT, BulletTraits<Bullet::rice>::EXTENT, BulletTraits<Bullet::kunai>::EXTENT, BulletTraits<Bullet::star>::EXTENT
+};
+# if !USE_SHADER
+static void (* const GEOMETRY[Bullet::TYPE_COUNT])(Bullet::Circles&, Bullet::Circles&, sf::Color, float) = {
+    &BulletTraits<Bullet::orb>::geometry, &BulletTraits<Bullet::rice>::geometry, &BulletTraits<Bullet::kunai>::geometry, &BulletTraits<Bullet::star>::geometry
+};
+# endif
+
 Bullet::Bullet(Type type, sf::Color color, float radius, float x, float y, float dir, float speed, std::shared_ptr<BulletScript> script) {
     remove = false;
     alive = true;
@@ -49,8 +77,9 @@ Bullet::Bullet(Type type, sf::Color color, float radius, float x, float y, float
     rotSpeed = 0;
     rotAccel = 0;
     rotAccelCap = 0;
-    this->script = script;
+    this->script = script != nullptr ? script->clone() : nullptr; // deep copy, the template stays untouched
     scriptFinished = script == nullptr;
+    tag = 0;
 
 # if USE_SHADER
     switch (type) {
@@ -59,54 +88,106 @@ Bullet::Bullet(Type type, sf::Color color, float radius, float x, float y, float
         circle.setOrigin(circle.getRadius(), circle.getRadius());
         circle.setPosition(circle.getRadius(), circle.getRadius());
         circle.setFillColor(sf::Color::Transparent);
-        this->frontNode = std::make_shared<DrawableNode>([this](sf::RenderTarget& renderTarget, sf::Transform trans, int calcTick) {
-            renderTarget.draw(spriteFront, trans);
+        this->frontNode = makePooled<DrawableNode>([this](Renderer& renderer, const sf::Transform& trans, int calcTick) {
+            renderer.draw(spriteFront, trans);
             });
-        this->backNode = std::make_shared<DrawableNode>([this](sf::RenderTarget& renderTarget, sf::Transform trans, int calcTick) {
-            renderTarget.draw(spriteBack, trans);
+        this->backNode = makePooled<DrawableNode>([this](Renderer& renderer, const sf::Transform& trans, int calcTick) {
+            renderer.draw(spriteBack, trans);
             });
         break;
     }
 # else
-    this->frontNode = std::make_shared<DrawableNode>([this](sf::RenderTarget& renderTarget, sf::Transform trans, int calcTick) {
-
-        for (sf::CircleShape circle : frontCircles)
-            renderTarget.draw(circle, trans);
-    });
-    this->backNode = std::make_shared<DrawableNode>([this](sf::RenderTarget& renderTarget, sf::Transform trans, int calcTick) {
-        for (sf::CircleShape circle : backCircles)
-            renderTarget.draw(circle, trans);
-    });
+    // circles are pointed at by renderUpdate
+    this->frontNode = CircleNode::create();
+    this->backNode = CircleNode::create();
 # endif
-    frontRootNode->addChild((std::shared_ptr<Node>)this->frontNode);
-    backRootNode->addChild((std::shared_ptr<Node>)this->backNode);
+    // cull bounds (render radius before scaling, covers outlines)
+    float extent = BULLET_RENDER_RADIUS * 2.f * EXTENT[type];
+    sf::FloatRect bounds(-extent, -extent, extent * 2, extent * 2);
+    this->frontNode->setBounds(bounds);
+    this->backNode->setBounds(bounds);
+    frontRootNode->appendChild(this->frontNode);
+    backRootNode->appendChild(this->backNode);
 }
 
 Bullet::Bullet() : Bullet::Bullet(Type::orb, sf::Color::White, 0, 0, 0, 0, 0, nullptr) {}
 
-void Bullet::tick() {
-    if (time == 0) { // first frame stuff
-        // deep copy script
-        script = script->clone();
+// draw nodes are children of the layers in bullets order (see attachAll), so one walk over each layer next to the
+// bullets list finds them (foreign children are skipped)
+void Bullet::detachRemoved() {
+    std::size_t front = 0;
+    frontRootNode->removeChildrenIf([&front](const std::shared_ptr<Node>& node) {
+        if (front < bullets.size() && bullets[front]->frontNode == node) return bullets[front++]->remove;
+        return false;
+        });
+    std::size_t back = 0;
+    backRootNode->removeChildrenIf([&back](const std::shared_ptr<Node>& node) {
+        if (back < bullets.size() && bullets[back]->backNode == node) return bullets[back++]->remove;
+        return false;
+        });
+}
+
+void Bullet::applyType() {
+    float extent = BULLET_RENDER_RADIUS * 2.f * EXTENT[type];
+    sf::FloatRect bounds(-extent, -extent, extent * 2, extent * 2);
+    frontNode->setBounds(bounds);
+    backNode->setBounds(bounds);
+    // types that don't turn their nodes must not keep the last type's rotation
+    frontNode->tf.setRotation(0);
+    backNode->tf.setRotation(0);
+    rebatch = true;
+}
+
+void Bullet::setType(Type type) {
+    if (this->type == type) return;
+    this->type = type;
+    applyType();
+    updateTexture = true;
+}
+
+void Bullet::setDetail(bool outlines, bool backLayer, bool deathShrink) {
+    if (outlines != Bullet::outlines) {
+        Bullet::outlines = outlines;
+        for (const std::shared_ptr<Bullet>& b : bullets)
+            b->updateTexture = true;
+    }
+    Bullet::deathShrink = deathShrink;
+    // the back layer keeps its children while detached, so it can come back at any time
+    rootNode->assignChildren(backLayer ? 2 : 1, [backLayer](std::size_t i) { return i == 0 && backLayer ? backRootNode : frontRootNode; });
+}
+
+void Bullet::tickScript() {
+    if (remove || !alive) return;
+
+    // update scripts
+    if (!scriptFinished) {
+        scriptInstructions++;
+        if (script->apply(*this))
+            scriptFinished = true;
     }
+}
+
+void Bullet::tickMotion() {
+    (this->*TICK_MOTION[type])();
+}
+
+template <Bullet::Type T>
+void Bullet::tickMotion() {
     if (remove) return;
     // movement
     if (alive) {
-        // update scripts
-        if (!scriptFinished)
-            if (script->apply(*this))
-                scriptFinished = true;
-
         // move
-        x += std::cos(dir) * speed;
-        y += std::sin(dir) * speed;
+        float cosDir = std::cos(dir);
+        float sinDir = std::sin(dir);
+        x += cosDir * speed;
+        y += sinDir * speed;
         if (accel != 0) {
             speed += accel;
             if ((accel > 0 && speed > accelCap) || (accel < 0 && speed < accelCap)) speed = accelCap;
         }
 
         // collisions
-        if (std::pow(Player::pos.x - x, 2) + std::pow(Player::pos.y - y, 2) <= COLLISION_DIST_SQD) {
+        if (BulletTraits<T>::Hitbox::hits(Player::pos.x - x, Player::pos.y - y, radius, cosDir, sinDir)) {
             kill();
         }
     }
@@ -118,13 +199,7 @@ void Bullet::tick() {
     }
 
     // update draw 
-    static float INV_BDT = 1.f / BULLET_DEATH_TIME;
-    static float INV_BRR = 1.f / BULLET_RENDER_RADIUS;
-    float s = (alive ? 1 : (BULLET_DEATH_TIME - this->time) * INV_BDT) * radius * INV_BRR;
-    frontNode->tf.setScale(s, s);
-    frontNode->tf.setPosition(this->x, this->y);
-    backNode->tf.setScale(s, s);
-    backNode->tf.setPosition(this->x, this->y);
+    updateNodes<T>();
 
     // update time
     time++;
@@ -132,11 +207,120 @@ void Bullet::tick() {
     // remove
     if (!alive && time >= BULLET_DEATH_TIME) {
         remove = true;
-        frontRootNode->removeChild(this->frontNode);
-        backRootNode->removeChild(this->backNode);
+        removals++;
     }
 }
 
+template <Bullet::Type T>
+void Bullet::tickBatch() {
+    for (Bullet* b : batches[T]) {
+        b->tickScript();
+        b->tickMotion<T>();
+    }
+}
+
+void Bullet::tickBatches() {
+    tickBatch<orb>();
+    tickBatch<rice>();
+    tickBatch<kunai>();
+    tickBatch<star>();
+}
+
+void Bullet::updateNodes() {
+    (this->*UPDATE_NODES[type])();
+}
+
+template <Bullet::Type T>
+void Bullet::updateNodes() {
+    static float INV_BDT = 1.f / BULLET_DEATH_TIME;
+    static float INV_BRR = 1.f / BULLET_RENDER_RADIUS;
+    // without the shrink dying bullets get zero size (culled)
+    float s = (alive ? 1 : deathShrink ? (BULLET_DEATH_TIME - this->time) * INV_BDT : 0) * radius * INV_BRR;
+    frontNode->tf.setScale(s, s);
+    frontNode->tf.setPosition(this->x, this->y);
+    backNode->tf.setScale(s, s);
+    backNode->tf.setPosition(this->x, this->y);
+    if (BulletTraits<T>::ORIENTED || BulletTraits<T>::SPIN != 0) {
+        float degrees = BulletTraits<T>::ORIENTED ? dir * (float)(180 / M_PI) : time * BulletTraits<T>::SPIN;
+        frontNode->tf.setRotation(degrees);
+        backNode->tf.setRotation(degrees);
+    }
+}
+
+# if !USE_SHADER
+void Bullet::buildCircles() {
+    // assign keeps the vectors' storage when the texture is updated again
+    GEOMETRY[type](frontCircles, backCircles, color, (float)BULLET_RENDER_RADIUS);
+    for (sf::CircleShape& circle : frontCircles) {
+        circle.setOrigin(circle.getRadius(), circle.getRadius());
+        if (!outlines) circle.setOutlineThickness(0);
+    }
+    for (sf::CircleShape& circle : backCircles) {
+        circle.setOrigin(circle.getRadius(), circle.getRadius());
+        if (!outlines) circle.setOutlineThickness(0);
+    }
+    frontNode->setCircles(frontCircles.data(), frontCircles.size());
+    backNode->setCircles(backCircles.data(), backCircles.size());
+}
+# endif
+
+void Bullet::saveState(SnapshotWriter& out) {
+    out.write(remove);
+    out.write(alive);
+    out.write(updateTexture);
+    out.write(time);
+    out.write(type);
+    out.write(radius);
+    out.write(x);
+    out.write(y);
+    out.write(dir);
+    out.write(speed);
+    out.write(accel);
+    out.write(accelCap);
+    out.write(color);
+    out.write(scriptFinished);
+    out.write(tag);
+    out.write(rotate);
+    out.write(rotOrigin);
+    out.write(rotDist);
+    out.write(rotSpeed);
+    out.write(rotAccel);
+    out.write(rotAccelCap);
+    if (script) script->saveState(out);
+}
+
+void Bullet::loadState(SnapshotReader& in) {
+    sf::Color oldColor = color;
+    Type oldType = type;
+    in.read(remove);
+    in.read(alive);
+    in.read(updateTexture);
+    in.read(time);
+    in.read(type);
+    in.read(radius);
+    in.read(x);
+    in.read(y);
+    in.read(dir);
+    in.read(speed);
+    in.read(accel);
+    in.read(accelCap);
+    in.read(color);
+    in.read(scriptFinished);
+    in.read(tag);
+    in.read(rotate);
+    in.read(rotOrigin);
+    in.read(rotDist);
+    in.read(rotSpeed);
+    in.read(rotAccel);
+    in.read(rotAccelCap);
+    if (script) script->loadState(in);
+
+    // render caches follow the restored state (updateTexture was restored too, so nothing else rebuilds them)
+    if (type != oldType) applyType();
+    if (color != oldColor || type != oldType) renderUpdate();
+    updateNodes();
+}
+
 float Bullet::leftX = NAN;
 float Bullet::rightX = NAN;
 float Bullet::topY = NAN;
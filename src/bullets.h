@@ -3,12 +3,15 @@
 
 # include "./scenegraph.h"
 # include "./player.h"
+# include "./profiler.h"
+# include "./snapshot.h"
 
 # include <SFML/Graphics.hpp>
 # include <memory>
 # include <deque>
 # include <vector>
 # include <cmath>
+# include <functional>
 
 # define USE_SHADER false
 
@@ -144,6 +147,17 @@ const float div255 = 1.f / 255.f;
 class BulletScript;
 
 class Bullet {
+public:
+    // shape of a bullet, behaviour per type is compile time (BulletTraits in bullettypes.h)
+    enum Type {
+        orb,
+        rice,
+        kunai,
+        star,
+    };
+    static constexpr int TYPE_COUNT = star + 1;
+
+    typedef std::vector<sf::CircleShape, PoolAllocator<sf::CircleShape>> Circles;
 private:
 # if USE_SHADER
     static sf::Shader bulletFrontShader;
@@ -151,13 +165,17 @@ private:
 # endif
 
     static const int BULLET_RENDER_RADIUS;
-    static const float COLLISION_DIST_SQD;
     static const int BULLET_DEATH_TIME;
 
     static sf::Vector2u wSize;
 
+# if USE_SHADER
     std::shared_ptr<DrawableNode> frontNode;
     std::shared_ptr<DrawableNode> backNode;
+# else
+    std::shared_ptr<CircleNode> frontNode;
+    std::shared_ptr<CircleNode> backNode;
+# endif
 
 # if USE_SHADER
     sf::Texture textureFront;
@@ -165,8 +183,8 @@ private:
     sf::Sprite spriteFront;
     sf::Sprite spriteBack;
 # else
-    std::vector<sf::CircleShape> frontCircles;
-    std::vector<sf::CircleShape> backCircles;
+    Circles frontCircles;
+    Circles backCircles;
 # endif
 
     static float leftX;
@@ -177,15 +195,56 @@ private:
 # if USE_SHADER
     static std::vector<std::shared_ptr<Bullet>> deleteQueue;
 # endif
-public:
-    enum Type {
-        orb,
+
+    // place draw nodes at the bullet (shrinking while dying, turned as the type says)
+    template <Type T>
+    void updateNodes();
+    void updateNodes();
+
+    // move, collide and update draw state with the kernels of type T
+    template <Type T>
+    void tickMotion();
+
+    // script and motion of a batch (no per bullet type branch)
+    template <Type T>
+    static void tickBatch();
+
+    static std::size_t removals; // bullets marked for removal since the last compaction
+    static bool rebatch; // a bullet changed type, batches are rebuilt before they are next read
+    static bool outlines; // circles keep their outlines (see setDetail)
+    static bool deathShrink; // dying bullets shrink (otherwise they stop being drawn)
+
+    // drop the draw nodes of removed bullets in one pass over the layers (before compacting bullets)
+    static void detachRemoved();
+
+    // cull bounds, node rotation and batch of the current type (geometry is left to renderUpdate)
+    void applyType();
+
+    // per type entry points for the paths that only know the type at runtime (indexed by Type)
+    static void (Bullet::* const TICK_MOTION[TYPE_COUNT])();
+    static void (Bullet::* const UPDATE_NODES[TYPE_COUNT])();
+
+# if !USE_SHADER
+    // circles of the type's geometry, pointed at by the draw nodes
+    void buildCircles();
+# endif
+
+    struct DeathListener {
+        int id;
+        std::function<void(Bullet&)> call;
     };
+    static std::vector<DeathListener> deathListeners; // called in the order added
+    static int nextDeathListener;
+public:
 
     static std::shared_ptr<Node> rootNode;
     static std::shared_ptr<Node> frontRootNode;
     static std::shared_ptr<Node> backRootNode;
-    static std::vector<std::shared_ptr<Bullet>> bullets;
+    static std::vector<std::shared_ptr<Bullet>> bullets; // creation order (scripts, snapshots and draw order)
+    static std::vector<Bullet*> batches[TYPE_COUNT]; // bullets of each type (owned by bullets)
+    static long long scriptInstructions; // script applies run by the last move tick (including nested scripts)
+    static long long spawned; // bullets created since start
+    static long long removed; // bullets removed since start
 
     static void init(sf::Vector2u windowSize, float leftX, float rightX, float topY, float bottomY) {
         rootNode->addChild(backRootNode);
@@ -215,6 +274,7 @@ public:
     sf::CircleShape circle;
     std::shared_ptr<BulletScript> script;
     bool scriptFinished;
+    int tag; // group set by scripts (bulk queries select on it)
 
     // rotate info
     // note: when rotating, speed/accel = dist speed/accel, dir = dir, and rotation has seperate accel parameter
@@ -226,23 +286,37 @@ public:
     Bullet();
     Bullet(Type type, sf::Color color, float radius, float x, float y, float dir, float speed, std::shared_ptr<BulletScript> script);
 
-    // create bullet and put into bullets list
+    // create bullet and put into bullets list (the bullet runs its own clone of script, so one script can be shared as a template)
     static std::shared_ptr<Bullet> create(Type type, sf::Color color, float radius, float x, float y, float dir, float speed, std::shared_ptr<BulletScript> script);
 
     // run move tick for all bullets
     static void moveTick(int calcTick) {
-        // move bullets
-        for (std::shared_ptr<Bullet> b : bullets)
-            b->tick();
-
-        // remove dead bullets
-        auto it = std::remove_if(bullets.begin(), bullets.end(), [](const std::shared_ptr<Bullet>& b) {
-            return b->remove;
-            });
+        PROFILE_ZONE("Bullet::moveTick");
+
+        // each bullet runs its script, then moves (batch by batch)
+        scriptInstructions = 0;
+        {
+            PROFILE_ZONE("bullet update");
+            updateBatches();
+            tickBatches();
+        }
+
+        // remove dead bullets (one compaction for everything that finished dying this tick)
+        PROFILE_ZONE("bullet removal");
+        if (removals != 0) {
+            removed += removals;
+            removals = 0;
+            detachRemoved();
+            for (std::vector<Bullet*>& batch : batches)
+                batch.erase(std::remove_if(batch.begin(), batch.end(), [](Bullet* b) { return b->remove; }), batch.end());
+            auto it = std::remove_if(bullets.begin(), bullets.end(), [](const std::shared_ptr<Bullet>& b) {
+                return b->remove;
+                });
 # if USE_SHADER
-        deleteQueue.insert(deleteQueue.begin(), it, bullets.end());
+            deleteQueue.insert(deleteQueue.begin(), it, bullets.end());
 # endif
-        bullets.erase(it, bullets.end());
+            bullets.erase(it, bullets.end());
+        }
 
 # if USE_SHADER
         // update dead bullet queue
@@ -250,16 +324,62 @@ public:
 # endif
     }
 
+    // simulation state including script state (script pointer itself is kept by the snapshot)
+    void saveState(SnapshotWriter& out);
+
+    // restore state written by saveState (draw nodes are moved, attaching them is left to attachAll)
+    void loadState(SnapshotReader& in);
+
+    // make exactly the bullets in the bullets list drawn (draw nodes in list order) and batched
+    static void attachAll() {
+        frontRootNode->assignChildren(bullets.size(), [](std::size_t i) { return bullets[i]->frontNode; });
+        backRootNode->assignChildren(bullets.size(), [](std::size_t i) { return bullets[i]->backNode; });
+        rebuildBatches();
+    }
+
+    // sort bullets into batches by type (in list order)
+    static void rebuildBatches() {
+        for (std::vector<Bullet*>& batch : batches)
+            batch.clear();
+        for (const std::shared_ptr<Bullet>& b : bullets)
+            batches[b->type].push_back(b.get());
+        rebatch = false;
+    }
+
+    // rebuild the batches if a bullet changed type since they were built (before anything reads them)
+    static void updateBatches() {
+        if (rebatch) rebuildBatches();
+    }
+
+    // visual detail (simulation is unaffected): outlines on the circles, the glow layer behind bullets and the shrink
+    // of dying bullets
+    static void setDetail(bool outlines, bool backLayer, bool deathShrink);
+
+    // change the bullet's type (geometry is rebuilt on its next tick, batches before they are next read)
+    void setType(Type type);
+
     void kill() {
         if (!alive) return;
         alive = false;
         time = 0;
+        for (const DeathListener& listener : deathListeners)
+            listener.call(*this);
+    }
+
+    // call fn whenever a bullet gets killed (to hook in effects), returns the id that removes it
+    static int addDeathListener(std::function<void(Bullet&)> fn) {
+        deathListeners.push_back({ nextDeathListener, fn });
+        return nextDeathListener++;
+    }
+
+    static void removeDeathListener(int id) {
+        deathListeners.erase(std::remove_if(deathListeners.begin(), deathListeners.end(), [id](const DeathListener& l) { return l.id == id; }), deathListeners.end());
     }
 
     void renderUpdate() {
-        switch (type) {
-        case orb:
 # if USE_SHADER
+        switch (type) { // textures are only made for orbs
+        case orb:
             static sf::RenderTexture rtFront;
             static sf::RenderTexture rtBack;
             int ts = std::ceil(circle.getRadius() * 2);
@@ -293,30 +413,27 @@ public:
             textureBack = rtBack.getTexture();
             spriteBack = sf::Sprite(textureBack);
             spriteBack.setOrigin(ts * 0.5f, ts * 0.5f);
-# else
-            frontCircles = std::vector<sf::CircleShape>(1);
-            frontCircles[0].setRadius(BULLET_RENDER_RADIUS * 0.5);
-            frontCircles[0].setOutlineThickness(BULLET_RENDER_RADIUS * 0.25);
-            frontCircles[0].setFillColor(sf::Color::White);
-            frontCircles[0].setOutlineColor(sf::Color(255,255,255,200));
-            backCircles = std::vector<sf::CircleShape>(1);
-            backCircles[0].setRadius(BULLET_RENDER_RADIUS * 1);
-            backCircles[0].setOutlineThickness(BULLET_RENDER_RADIUS * 0.5);
-            backCircles[0].setFillColor(color);
-            backCircles[0].setOutlineColor(color * sf::Color(color.r, color.g, color.b, 64));
-# endif
             break;
         }
-        for (sf::CircleShape& circle : frontCircles) {
-            circle.setOrigin(circle.getRadius(), circle.getRadius());
-        }
-        for (sf::CircleShape& circle : backCircles) {
-            circle.setOrigin(circle.getRadius(), circle.getRadius());
-        }
+# else
+        buildCircles();
+# endif
+    }
+
+    // tick (script then motion)
+    void tick() {
+        tickScript();
+        tickMotion();
     }
 
-    // tick
-    void tick();
+    // run script
+    void tickScript();
+
+    // move, collide and update draw state
+    void tickMotion();
+
+    // script and motion of every batch
+    static void tickBatches();
 
     // returns true iff bullet off screen
     bool offScreen() {
@@ -3,7 +3,10 @@
 
 # include <SFML/Graphics.hpp>
 # include "./bullets.h"
+# include "./pool.h"
 # include <memory>
+# include <initializer_list>
+# include <memory_resource>
 
 class BulletScript {
 protected:
@@ -19,11 +22,17 @@ public:
 
     virtual void reset() {};
 
+    // mutable state for world snapshots (parameters are never changed by apply, so they are not saved)
+    virtual void saveState(SnapshotWriter& out) {}
+    virtual void loadState(SnapshotReader& in) {}
+
     virtual std::shared_ptr<BulletScript> clone() {
-        return std::make_shared<BulletScript>();
+        return makePooled<BulletScript>();
     };
 };
 
+typedef std::vector<std::shared_ptr<BulletScript>, PoolAllocator<std::shared_ptr<BulletScript>>> ScriptList; // storage comes from the pools
+
 class MoveScript : public BulletScript {
 protected:
     float x;
@@ -44,7 +53,7 @@ public:
     }
 
     std::shared_ptr<BulletScript> clone() override {
-        return std::make_shared<MoveScript>(x, y, relative);
+        return makePooled<MoveScript>(x, y, relative);
     }
 };
 
@@ -64,7 +73,7 @@ public:
     }
 
     std::shared_ptr<BulletScript> clone() override {
-        return std::make_shared<DirScript>(val, relative);
+        return makePooled<DirScript>(val, relative);
     }
 };
 
@@ -81,11 +90,25 @@ public:
     }
 
     std::shared_ptr<BulletScript> clone() override {
-        return std::make_shared<ColorScript>(color);
+        return makePooled<ColorScript>(color);
     }
 };
 
+class TagScript : public BulletScript {
+protected:
+    int tag;
+public:
+    TagScript(int tag) : tag(tag) {}
 
+    bool apply(Bullet& b) override {
+        b.tag = tag;
+        return true;
+    }
+
+    std::shared_ptr<BulletScript> clone() override {
+        return makePooled<TagScript>(tag);
+    }
+};
 
 class SpeedScript : public BulletScript {
 protected:
@@ -103,7 +126,7 @@ public:
     }
 
     std::shared_ptr<BulletScript> clone() override {
-        return std::make_shared<SpeedScript>(amount, relative);
+        return makePooled<SpeedScript>(amount, relative);
     }
 };
 
@@ -122,7 +145,7 @@ public:
     }
 
     std::shared_ptr<BulletScript> clone() override {
-        return std::make_shared<AccelScript>(amount, cap, waitUntilCapHit);
+        return makePooled<AccelScript>(amount, cap, waitUntilCapHit);
     }
 };
 
@@ -153,7 +176,7 @@ public:
     }
 
     std::shared_ptr<BulletScript> clone() override {
-        return std::make_shared<RotateEnableScript>(setOriginToPos);
+        return makePooled<RotateEnableScript>(setOriginToPos);
     }
 };
 
@@ -177,7 +200,7 @@ public:
     }
 
     std::shared_ptr<BulletScript> clone() override {
-        return std::make_shared<RotateDisableScript>(keepVelocity);
+        return makePooled<RotateDisableScript>(keepVelocity);
     }
 };
 
@@ -196,8 +219,16 @@ public:
         currentFrames = 0;
     }
 
+    void saveState(SnapshotWriter& out) override {
+        out.write(currentFrames);
+    }
+
+    void loadState(SnapshotReader& in) override {
+        in.read(currentFrames);
+    }
+
     std::shared_ptr<BulletScript> clone() override {
-        return std::make_shared<WaitTimeScript>(frames);
+        return makePooled<WaitTimeScript>(frames);
     }
 };
 
@@ -218,7 +249,7 @@ public:
     }
 
     std::shared_ptr<BulletScript> clone() override {
-        return std::make_shared<WaitUntilDistScript>(dist, within);
+        return makePooled<WaitUntilDistScript>(dist, within);
     }
 };
 
@@ -231,7 +262,7 @@ public:
     }
 
     std::shared_ptr<BulletScript> clone() override {
-        return std::make_shared<KillScript>();
+        return makePooled<KillScript>();
     }
 };
 
@@ -245,7 +276,7 @@ public:
     }
 
     std::shared_ptr<BulletScript> clone() override {
-        return std::make_shared<WaitUntilOffscreenScript>(inverse);
+        return makePooled<WaitUntilOffscreenScript>(inverse);
     }
 };
 
@@ -260,23 +291,24 @@ public:
     }
 
     std::shared_ptr<BulletScript> clone() override {
-        return std::make_shared<GenericScript>(applyFunction);
+        return makePooled<GenericScript>(applyFunction);
     }
 };
 
 // a sequential collection of scripts
 class Thread : public BulletScript {
 protected:
-    std::vector<std::shared_ptr<BulletScript>> scripts;
+    ScriptList scripts;
     bool loop; // if true, loops
     int index;
 public:
-    Thread(std::vector<std::shared_ptr<BulletScript>> scripts, bool loop) : scripts(scripts), loop(loop), index(0) {}
+    Thread(ScriptList scripts, bool loop) : scripts(std::move(scripts)), loop(loop), index(0) {}
 
     bool apply(Bullet& b) override {
         if (index >= scripts.size())
             return true;
         while (true) {
+            Bullet::scriptInstructions++;
             if (!scripts[index]->apply(b)) return false;
             index++;
             if (index == scripts.size()) {
@@ -294,30 +326,44 @@ public:
             script->reset();
     }
 
+    void saveState(SnapshotWriter& out) override {
+        out.write(index);
+        for (const std::shared_ptr<BulletScript>& script : scripts)
+            script->saveState(out);
+    }
+
+    void loadState(SnapshotReader& in) override {
+        in.read(index);
+        for (const std::shared_ptr<BulletScript>& script : scripts)
+            script->loadState(in);
+    }
+
     std::shared_ptr<BulletScript> clone() override {
-        std::vector<std::shared_ptr<BulletScript>> cScripts = scripts;
-        for (std::shared_ptr<BulletScript>& bs : cScripts) {
-            bs = bs->clone();
+        ScriptList cScripts;
+        cScripts.reserve(scripts.size());
+        for (const std::shared_ptr<BulletScript>& bs : scripts) {
+            cScripts.push_back(bs->clone());
         }
-        return std::make_shared<Thread>(cScripts, loop);
+        return makePooled<Thread>(std::move(cScripts), loop);
     }
 };
 
 // a parallel collection of scripts
 class Bundle : public BulletScript {
 protected:
-    std::vector<std::shared_ptr<BulletScript>> scripts;
-    std::vector<bool> active;
+    ScriptList scripts;
+    std::vector<bool, PoolAllocator<bool>> active;
     int activeCount;
 public:
-    Bundle(std::vector<std::shared_ptr<BulletScript>> scripts) : scripts(scripts), activeCount(0) {
-        active = std::vector<bool>(scripts.size(), true);
+    Bundle(ScriptList scripts) : scripts(std::move(scripts)), activeCount(0) {
+        active.assign(this->scripts.size(), true);
     }
 
     bool apply(Bullet& b) override {
         if (activeCount == scripts.size()) return true;
         for (int i = 0; i < scripts.size(); ++i) {
             if (active[i]) {
+                Bullet::scriptInstructions++;
                 if (!scripts[i]->apply(b)) {
                     active[i] = false;
                     activeCount++;
@@ -335,116 +381,178 @@ public:
         }
     }
 
+    void saveState(SnapshotWriter& out) override {
+        out.write(activeCount);
+        for (int i = 0; i < scripts.size(); ++i) {
+            out.write((bool)active[i]);
+            scripts[i]->saveState(out);
+        }
+    }
+
+    void loadState(SnapshotReader& in) override {
+        in.read(activeCount);
+        for (int i = 0; i < scripts.size(); ++i) {
+            bool a;
+            in.read(a);
+            active[i] = a;
+            scripts[i]->loadState(in);
+        }
+    }
+
     std::shared_ptr<BulletScript> clone() override {
-        std::vector<std::shared_ptr<BulletScript>> cScripts = scripts;
-        for (std::shared_ptr<BulletScript>& bs : cScripts) {
-            bs = bs->clone();
+        ScriptList cScripts;
+        cScripts.reserve(scripts.size());
+        for (const std::shared_ptr<BulletScript>& bs : scripts) {
+            cScripts.push_back(bs->clone());
         }
-        return std::make_shared<Bundle>(cScripts);
+        return makePooled<Bundle>(std::move(cScripts));
     }
 };
 
 // bullet script factory
 class BSF {
+private:
+    static std::pmr::memory_resource* resource; // where scripts are built (null: pools)
+
+    template <typename T, typename... Args>
+    static std::shared_ptr<BulletScript> make(Args&&... args) {
+        if (resource != nullptr) return std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(resource), std::forward<Args>(args)...);
+        return makePooled<T>(std::forward<Args>(args)...);
+    }
 public:
+    // while in scope, scripts are built in the frame arena
+    // only for templates handed straight to Bullet::create (bullets clone them), since the arena is reset at the end of the tick
+    class FrameScope {
+    private:
+        std::pmr::memory_resource* previous;
+    public:
+        FrameScope() : previous(resource) {
+            resource = &FrameArena::frame;
+        }
+
+        ~FrameScope() {
+            resource = previous;
+        }
+
+        FrameScope(const FrameScope&) = delete;
+        FrameScope& operator=(const FrameScope&) = delete;
+    };
+
     // changes position of bullet
     static std::shared_ptr<BulletScript> move(float x, float y) {
-        return std::make_shared<MoveScript>(x, y, true);
+        return make<MoveScript>(x, y, true);
     }
 
     // sets position of bullet
     static std::shared_ptr<BulletScript> goTo(float x, float y) {
-        return std::make_shared<MoveScript>(x, y, false);
+        return make<MoveScript>(x, y, false);
     }
 
     // changes direction of bullet
     static std::shared_ptr<BulletScript> turn(float dir) {
-        return std::make_shared<DirScript>(dir, true);
+        return make<DirScript>(dir, true);
     }
 
     // sets direction of bullet
     static std::shared_ptr<BulletScript> dir(float dir) {
-        return std::make_shared<DirScript>(dir, false);
+        return make<DirScript>(dir, false);
     }
 
     // sets color of bullet
     static std::shared_ptr<BulletScript> color(sf::Color color) {
-        return std::make_shared<ColorScript>(color);
+        return make<ColorScript>(color);
+    }
+
+    // sets tag of bullet (for bulk queries)
+    static std::shared_ptr<BulletScript> tag(int tag) {
+        return make<TagScript>(tag);
     }
 
     // changes speed of bullet
     static std::shared_ptr<BulletScript> changeSpeed(float speed) {
-        return std::make_shared<SpeedScript>(speed, true);
+        return make<SpeedScript>(speed, true);
     }
 
     // sets speed of bullet
     static std::shared_ptr<BulletScript> setSpeed(float speed) {
-        return std::make_shared<SpeedScript>(speed, false);
+        return make<SpeedScript>(speed, false);
     }
 
     // sets acceleration of bullet
     static std::shared_ptr<BulletScript> accel(float amount, float cap, bool waitUntilCapHit) {
-        return std::make_shared<AccelScript>(amount, cap, waitUntilCapHit);
+        return make<AccelScript>(amount, cap, waitUntilCapHit);
     }
 
     // enables rotation movement (if flag set, rotation origin set to current pos)
     static std::shared_ptr<BulletScript> enableRotate(bool setOriginToPos) {
-        return std::make_shared<RotateEnableScript>(setOriginToPos);
+        return make<RotateEnableScript>(setOriginToPos);
     }
 
     // disables rotation movement (if flag set, velocity maintained)
     static std::shared_ptr<BulletScript> disableRotate(bool keepVelocity) {
-        return std::make_shared<RotateDisableScript>(keepVelocity);
+        return make<RotateDisableScript>(keepVelocity);
     }
 
     // waits a set amount of frames
     static std::shared_ptr<BulletScript> wait(unsigned int frames) {
-        return std::make_shared<WaitTimeScript>(frames);
+        return make<WaitTimeScript>(frames);
     }
 
     // waits until player within a certain range of bullet
     static std::shared_ptr<BulletScript> waitUntilInside(float dist) {
-        return std::make_shared<WaitUntilDistScript>(dist, true);
+        return make<WaitUntilDistScript>(dist, true);
     }
 
     // waits until player outside a certain range of bullet
     static std::shared_ptr<BulletScript> waitUntilOutside(float dist) {
-        return std::make_shared<WaitUntilDistScript>(dist, false);
+        return make<WaitUntilDistScript>(dist, false);
     }
 
     // kills bullet
     static std::shared_ptr<BulletScript> kill() {
-        return std::make_shared<KillScript>();
+        return make<KillScript>();
     }
 
     // waits until bullet offscreen
     static std::shared_ptr<BulletScript> waitUntilOffscreen() {
-        return std::make_shared<WaitUntilOffscreenScript>(false);
+        return make<WaitUntilOffscreenScript>(false);
     }
 
     // waits until bullet onscreen
     static std::shared_ptr<BulletScript> waitUntilOnscreen() {
-        return std::make_shared<WaitUntilOffscreenScript>(true);
+        return make<WaitUntilOffscreenScript>(true);
     }
 
     // create generic script
     static std::shared_ptr<BulletScript> script(std::function<bool(Bullet&)> applyFunction) {
-        return std::make_shared<GenericScript>(applyFunction);
+        return make<GenericScript>(applyFunction);
     }
 
     // create thread
-    static std::shared_ptr<BulletScript> thread(std::vector<std::shared_ptr<BulletScript>> scripts) {
-        return std::make_shared<Thread>(scripts, false);
+    static std::shared_ptr<BulletScript> thread(const std::vector<std::shared_ptr<BulletScript>>& scripts) {
+        return make<Thread>(ScriptList(scripts.begin(), scripts.end()), false);
+    }
+
+    static std::shared_ptr<BulletScript> thread(std::initializer_list<std::shared_ptr<BulletScript>> scripts) {
+        return make<Thread>(ScriptList(scripts), false);
     }
 
     // create looped thread
-    static std::shared_ptr<BulletScript> threadLoop(std::vector<std::shared_ptr<BulletScript>> scripts) {
-        return std::make_shared<Thread>(scripts, true);
+    static std::shared_ptr<BulletScript> threadLoop(const std::vector<std::shared_ptr<BulletScript>>& scripts) {
+        return make<Thread>(ScriptList(scripts.begin(), scripts.end()), true);
+    }
+
+    static std::shared_ptr<BulletScript> threadLoop(std::initializer_list<std::shared_ptr<BulletScript>> scripts) {
+        return make<Thread>(ScriptList(scripts), true);
     }
 
     // create bundle
-    static std::shared_ptr<BulletScript> bundle(std::vector<std::shared_ptr<BulletScript>> scripts) {
-        return std::make_shared<Bundle>(scripts);
+    static std::shared_ptr<BulletScript> bundle(const std::vector<std::shared_ptr<BulletScript>>& scripts) {
+        return make<Bundle>(ScriptList(scripts.begin(), scripts.end()));
+    }
+
+    static std::shared_ptr<BulletScript> bundle(std::initializer_list<std::shared_ptr<BulletScript>> scripts) {
+        return make<Bundle>(ScriptList(scripts));
     }
 };
 
@@ -0,0 +1,144 @@
+# ifndef BULLETTYPES_H
+# define BULLETTYPES_H
+
+# include "./bullets.h"
+
+# include <SFML/Graphics.hpp>
+# include <algorithm>
+# include <cmath>
+
+// collision kernels: whether a point (dx, dy) away from the bullet's center is inside its hitbox
+// sizes come from the traits in bullet radii, oriented hitboxes are aligned with the direction of travel (cosDir, sinDir)
+template <typename Traits>
+struct CircleHitbox {
+    static bool hits(float dx, float dy, float radius, float cosDir, float sinDir) {
+        float r = Traits::HIT_RADIUS * radius;
+        return dx * dx + dy * dy <= r * r;
+    }
+};
+
+// HIT_LENGTH is the half axis along the direction of travel, HIT_RADIUS the one across it
+template <typename Traits>
+struct EllipseHitbox {
+    static bool hits(float dx, float dy, float radius, float cosDir, float sinDir) {
+        float along = dx * cosDir + dy * sinDir;
+        float across = dy * cosDir - dx * sinDir;
+        float a = Traits::HIT_LENGTH * radius;
+        float b = Traits::HIT_RADIUS * radius;
+        return along * along * (b * b) + across * across * (a * a) <= a * a * b * b;
+    }
+};
+
+// segment of half length HIT_LENGTH along the direction of travel, grown by HIT_RADIUS
+template <typename Traits>
+struct CapsuleHitbox {
+    static bool hits(float dx, float dy, float radius, float cosDir, float sinDir) {
+        float along = std::max(std::abs(dx * cosDir + dy * sinDir) - Traits::HIT_LENGTH * radius, 0.f);
+        float across = dy * cosDir - dx * sinDir;
+        float r = Traits::HIT_RADIUS * radius;
+        return along * along + across * across <= r * r;
+    }
+};
+
+// compile time description of a bullet type:
+// Hitbox - collision kernel (with HIT_RADIUS / HIT_LENGTH)
+// ORIENTED - draw nodes rotated to the direction of travel
+// SPIN - degrees per tick the draw nodes turn (unoriented types)
+// EXTENT - drawn size in render radii (cull bounds)
+// geometry - circles drawn behind (back) and on top (front) of every bullet, R is the render radius
+template <Bullet::Type T>
+struct BulletTraits;
+
+// round bullet
+template <>
+struct BulletTraits<Bullet::orb> {
+    typedef CircleHitbox<BulletTraits> Hitbox;
+    static constexpr float HIT_RADIUS = 1 / 3.f;
+    static constexpr bool ORIENTED = false;
+    static constexpr float SPIN = 0;
+    static constexpr float EXTENT = 1;
+
+    static void geometry(Bullet::Circles& front, Bullet::Circles& back, sf::Color color, float R) {
+        front.assign(1, sf::CircleShape());
+        front[0].setRadius(R * 0.5f);
+        front[0].setOutlineThickness(R * 0.25f);
+        front[0].setFillColor(sf::Color::White);
+        front[0].setOutlineColor(sf::Color(255, 255, 255, 200));
+        back.assign(1, sf::CircleShape());
+        back[0].setRadius(R);
+        back[0].setOutlineThickness(R * 0.5f);
+        back[0].setFillColor(color);
+        back[0].setOutlineColor(color * sf::Color(color.r, color.g, color.b, 64));
+    }
+};
+
+// grain shaped (ellipse along the direction of travel)
+template <>
+struct BulletTraits<Bullet::rice> {
+    typedef EllipseHitbox<BulletTraits> Hitbox;
+    static constexpr float HIT_LENGTH = 0.5f;
+    static constexpr float HIT_RADIUS = 0.25f;
+    static constexpr bool ORIENTED = true;
+    static constexpr float SPIN = 0;
+    static constexpr float EXTENT = 1;
+
+    static void geometry(Bullet::Circles& front, Bullet::Circles& back, sf::Color color, float R) {
+        front.assign(1, sf::CircleShape(R * 0.45f, 20));
+        front[0].setScale(1.5f, 0.6f);
+        front[0].setFillColor(sf::Color::White);
+        back.assign(1, sf::CircleShape(R, 24));
+        back[0].setScale(1.5f, 0.75f);
+        back[0].setOutlineThickness(R * 0.3f);
+        back[0].setFillColor(color);
+        back[0].setOutlineColor(color * sf::Color(color.r, color.g, color.b, 64));
+    }
+};
+
+// blade (long triangle pointing in the direction of travel)
+template <>
+struct BulletTraits<Bullet::kunai> {
+    typedef CapsuleHitbox<BulletTraits> Hitbox;
+    static constexpr float HIT_LENGTH = 0.5f;
+    static constexpr float HIT_RADIUS = 0.2f;
+    static constexpr bool ORIENTED = true;
+    static constexpr float SPIN = 0;
+    static constexpr float EXTENT = 1;
+
+    static void geometry(Bullet::Circles& front, Bullet::Circles& back, sf::Color color, float R) {
+        // a triangle's first point is at the top, rotating by 90 degrees makes it the tip (scale is applied before rotation)
+        front.assign(1, sf::CircleShape(R * 0.3f, 12));
+        front[0].setScale(0.5f, 2.f);
+        front[0].setRotation(90);
+        front[0].setFillColor(sf::Color::White);
+        back.assign(1, sf::CircleShape(R, 3));
+        back[0].setScale(0.6f, 1.6f);
+        back[0].setRotation(90);
+        back[0].setOutlineThickness(R * 0.15f);
+        back[0].setFillColor(color);
+        back[0].setOutlineColor(color * sf::Color(color.r, color.g, color.b, 96));
+    }
+};
+
+// six pointed star (two triangles), spinning
+template <>
+struct BulletTraits<Bullet::star> {
+    typedef CircleHitbox<BulletTraits> Hitbox;
+    static constexpr float HIT_RADIUS = 0.4f;
+    static constexpr bool ORIENTED = false;
+    static constexpr float SPIN = 3;
+    static constexpr float EXTENT = 1;
+
+    static void geometry(Bullet::Circles& front, Bullet::Circles& back, sf::Color color, float R) {
+        front.assign(1, sf::CircleShape(R * 0.35f));
+        front[0].setFillColor(sf::Color::White);
+        back.assign(2, sf::CircleShape(R, 3));
+        back[1].setRotation(180);
+        for (sf::CircleShape& triangle : back) {
+            triangle.setOutlineThickness(R * 0.15f);
+            triangle.setFillColor(color);
+            triangle.setOutlineColor(color * sf::Color(color.r, color.g, color.b, 96));
+        }
+    }
+};
+
+# endif
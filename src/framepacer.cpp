@@ -0,0 +1,102 @@
+#include "./framepacer.h"
+#include "./profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+void JitterHistogram::record(std::chrono::nanoseconds deviation) {
+    long long ns = deviation.count() < 0 ? -deviation.count() : deviation.count();
+    buckets[(int)std::min<long long>(ns / BUCKET, BUCKETS - 1)]++;
+    max = std::max(max, ns);
+    count++;
+}
+
+long long JitterHistogram::percentile(double p) const {
+    if (count == 0) return 0;
+    long long rank = std::max<long long>(1, (long long)(p * count + 0.5));
+    long long seen = 0;
+    for (int i = 0; i < BUCKETS - 1; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) return std::min((i + 1) * BUCKET, max);
+    }
+    return max;
+}
+
+void JitterHistogram::reset() {
+    std::fill(buckets.begin(), buckets.end(), 0);
+    count = max = 0;
+}
+
+std::string JitterHistogram::log() const {
+    if (count == 0) return "jitter: <no frames>";
+    char s[96];
+    std::snprintf(s, sizeof(s), "jitter: p50 %lldus p99 %lldus max %lldus", percentile(0.5) / 1000, percentile(0.99) / 1000, max / 1000);
+    return s;
+}
+
+FramePacer::Clock::time_point FramePacer::nextDeadline() {
+    deadline += period;
+    Clock::time_point now = Clock::now();
+    if (now > deadline) deadline = now; // fell behind (don't try to catch up)
+    return deadline;
+}
+
+void FramePacer::waitUntil(Clock::time_point t, const std::function<void()>& idle) {
+    PROFILE_ZONE("FramePacer::waitUntil");
+
+    // coarse: sleep while the next wake up can't overshoot t
+    for (Clock::time_point now = Clock::now(); t - now > sleepMargin; now = Clock::now()) {
+        if (idle) idle();
+        now = Clock::now();
+        std::chrono::nanoseconds request = std::min(MAX_SLEEP, std::chrono::duration_cast<std::chrono::nanoseconds>(t - now - sleepMargin));
+        if (request.count() <= 0) break;
+        std::this_thread::sleep_for(request);
+
+        // margin follows the worst recent oversleep, decaying slowly when sleeps get more accurate
+        std::chrono::nanoseconds oversleep = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - now) - request;
+        sleepMargin = std::max(sleepMargin * 63 / 64, oversleep * 5 / 4);
+        sleepMargin = std::min(MAX_MARGIN, std::max(MIN_MARGIN, sleepMargin));
+    }
+
+    // fine: yield until t
+    if (idle) idle();
+    while (Clock::now() < t)
+        std::this_thread::yield();
+}
+
+void FramePacer::framePresented(Clock::time_point t) {
+    if (presented) {
+        std::chrono::nanoseconds deviation = std::chrono::duration_cast<std::chrono::nanoseconds>(t - lastPresent) - period;
+        jitter.record(deviation);
+        totalJitter.record(deviation);
+    }
+    lastPresent = t;
+    presented = true;
+}
+
+bool FramePacer::adaptToRefresh(std::chrono::nanoseconds refresh, double tolerance) {
+    if (refresh.count() <= 0) return false;
+    long long multiple = std::max<long long>(1, (nominalPeriod.count() + refresh.count() / 2) / refresh.count());
+    std::chrono::nanoseconds locked = refresh * multiple;
+    double error = (double)(locked - nominalPeriod).count() / nominalPeriod.count();
+    if (error < -tolerance || error > tolerance || locked == period) return false;
+    period = locked;
+    return true;
+}
+
+std::chrono::nanoseconds FramePacer::measureRefresh(const std::function<void()>& present, int frames) {
+    std::vector<long long> intervals;
+    present(); // align to a refresh first
+    Clock::time_point last = Clock::now();
+    for (int i = 0; i < frames; ++i) {
+        present();
+        Clock::time_point now = Clock::now();
+        intervals.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count());
+        last = now;
+    }
+    if (intervals.empty()) return std::chrono::nanoseconds(0);
+    std::nth_element(intervals.begin(), intervals.begin() + intervals.size() / 2, intervals.end());
+    long long median = intervals[intervals.size() / 2];
+    return std::chrono::nanoseconds(median < 1000000 ? 0 : median); // under 1ms: present did not block
+}
@@ -0,0 +1,91 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+// histogram of frame interval deviations from the target period
+class JitterHistogram {
+public:
+    static constexpr long long BUCKET = 50000; // ns
+    static constexpr int BUCKETS = 400; // last bucket also holds everything above
+private:
+    std::vector<unsigned> buckets;
+    long long count;
+    long long max; // ns
+public:
+    JitterHistogram() : buckets(BUCKETS), count(0), max(0) {}
+
+    void record(std::chrono::nanoseconds deviation);
+
+    // upper bound of the bucket holding the p-th fraction of samples (ns, 0 if empty)
+    long long percentile(double p) const;
+
+    long long getMax() const {
+        return max;
+    }
+
+    long long getCount() const {
+        return count;
+    }
+
+    void reset();
+
+    // p50/p99/max in us
+    std::string log() const;
+};
+
+// paces frames to deadlines on a monotonic clock
+// sleeps until shortly before the target (margin learned from how late sleeps wake up) and yields the rest of the way,
+// so frames are delivered at the target time instead of whenever the os timer fires
+class FramePacer {
+public:
+    typedef std::chrono::steady_clock Clock;
+private:
+    static constexpr std::chrono::nanoseconds MIN_MARGIN = std::chrono::microseconds(200);
+    static constexpr std::chrono::nanoseconds MAX_MARGIN = std::chrono::milliseconds(4);
+    static constexpr std::chrono::nanoseconds MAX_SLEEP = std::chrono::milliseconds(1); // idle callback runs at least this often
+
+    std::chrono::nanoseconds period;
+    const std::chrono::nanoseconds nominalPeriod;
+    Clock::time_point deadline;
+    std::chrono::nanoseconds sleepMargin; // expected oversleep
+    Clock::time_point lastPresent;
+    bool presented;
+    JitterHistogram jitter; // since last reset
+    JitterHistogram totalJitter; // since start
+public:
+    FramePacer(std::chrono::nanoseconds period) : period(period), nominalPeriod(period), deadline(Clock::now()), sleepMargin(std::chrono::milliseconds(2)), presented(false) {}
+
+    // advance to the next frame slot and return its deadline (skips ahead instead of catching up if behind)
+    Clock::time_point nextDeadline();
+
+    // block until t, calling idle (if any) between sleeps
+    void waitUntil(Clock::time_point t, const std::function<void()>& idle = nullptr);
+
+    // record the time a frame reached the screen (interval to the previous one goes into the jitter histograms)
+    void framePresented(Clock::time_point t);
+
+    // lock the period to the measured display refresh (or a multiple of it) if it is within tolerance of the nominal period
+    // returns whether the period changed
+    bool adaptToRefresh(std::chrono::nanoseconds refresh, double tolerance = 0.03);
+
+    // median interval between calls of a blocking present (e.g. display with vsync on), 0 if it did not block
+    static std::chrono::nanoseconds measureRefresh(const std::function<void()>& present, int frames);
+
+    std::chrono::nanoseconds getPeriod() const {
+        return period;
+    }
+
+    JitterHistogram& getJitter() {
+        return jitter;
+    }
+
+    const JitterHistogram& getTotalJitter() const {
+        return totalJitter;
+    }
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+// measurements of one frame
+struct FrameStats {
+    int tick;
+    float inputTime; // ms
+    float calcTime;
+    float drawTime;
+    float frameTime;
+    int bullets;
+    int spawned; // bullets created this frame
+    int removed; // bullets removed this frame
+    int nodes; // drawn
+    int culled;
+    int drawCalls;
+    int voices; // sound effect voices playing
+    int audioDrops; // mixer commands dropped this frame (command queue full)
+    long long scriptInstructions;
+    long long allocations; // -1 if not tracked
+    int poolBlocks; // pool blocks in use
+    int poolCapacity; // pool blocks carved
+    int arenaBytes; // frame arena bytes used this frame
+    float jitterP50; // ms, frame interval deviation over the current second
+    float jitterP99;
+    float jitterMax;
+    int quality; // quality tier (0 is full detail)
+
+    FrameStats() : tick(0), inputTime(0), calcTime(0), drawTime(0), frameTime(0), bullets(0), spawned(0), removed(0), nodes(0), culled(0), drawCalls(0), voices(0), audioDrops(0),
+        scriptInstructions(0), allocations(-1), poolBlocks(0), poolCapacity(0), arenaBytes(0), jitterP50(0), jitterP99(0), jitterMax(0), quality(0) {}
+};
+
+#endif
@@ -1,27 +1,63 @@
 # include "./input.h"
+# include "./profiler.h"
 
-std::unordered_map<std::string, Input::Data> Input::idMap = std::unordered_map<std::string, Input::Data>();
-std::unordered_map<sf::Keyboard::Key, Input::Data*> Input::keyMap = std::unordered_map<sf::Keyboard::Key, Input::Data*>();
-std::vector<std::pair<sf::Keyboard::Key, bool>> Input::events = std::vector<std::pair<sf::Keyboard::Key, bool>>();
-Input::Data Input::nullData = Input::Data();
+# include <algorithm>
+
+std::unordered_map<std::string, Input::Action> Input::actionIds = std::unordered_map<std::string, Input::Action>();
+std::array<Input::Action, sf::Keyboard::KeyCount> Input::keyActions = [] {
+    std::array<Input::Action, sf::Keyboard::KeyCount> a;
+    a.fill(Input::NONE);
+    return a;
+}();
+std::bitset<sf::Keyboard::KeyCount> Input::keysDown = std::bitset<sf::Keyboard::KeyCount>();
+unsigned char Input::actionKeysDown[Input::MAX_ACTIONS] = {};
+std::vector<Input::Event> Input::events = std::vector<Input::Event>();
+std::vector<Input::Event> Input::tickEventList = std::vector<Input::Event>();
+Input::Snapshot Input::state = Input::Snapshot();
 
 void Input::inputTick() {
-    // change just to false
-    for (auto& kvp : idMap)
-        kvp.second.tick();
+    PROFILE_ZONE("Input::inputTick");
+
+    // just flags only last a tick
+    state.justPressed.reset();
+    state.justReleased.reset();
+
+    // events can be sampled from several places in a frame, keep them in the order they happened
+    std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+        return a.time < b.time;
+        });
 
     // update state of inputs that got updated
-    for (const auto& e : events) {
-        if (keyMap.find(e.first) == keyMap.end()) continue;
-        keyMap[e.first]->update(e.first, e.second);
+    for (const Event& e : events) {
+        if (e.key < 0 || e.key >= sf::Keyboard::KeyCount) continue;
+        Action a = keyActions[e.key];
+        if (a == NONE || keysDown[e.key] == e.pressed) continue;
+        keysDown[e.key] = e.pressed;
+        actionKeysDown[a] += e.pressed ? 1 : -1;
+        bool pressed = actionKeysDown[a] != 0;
+        if (pressed == state.pressed[a]) continue;
+        state.pressed[a] = pressed;
+        if (pressed)
+            state.justPressed[a] = true;
+        else
+            state.justReleased[a] = true;
     }
+
+    // keep applied events around for the tick (swap to reuse storage)
+    tickEventList.swap(events);
     events.clear();
 }
 
-void Input::mapInput(sf::Keyboard::Key key, std::string id) {
-    keyMap[key] = &idMap[id];
+Input::Action Input::mapInput(sf::Keyboard::Key key, const std::string& id) {
+    auto it = actionIds.find(id);
+    Action a;
+    if (it != actionIds.end()) {
+        a = it->second;
+    } else {
+        if (actionIds.size() == NONE) throw("too many inputs mapped");
+        a = actionIds.size();
+        actionIds[id] = a;
+    }
+    keyActions[key] = a;
+    return a;
 }
-
-Input::Data& Input::get(std::string id) {
-    return idMap.count(id) == 0 ? nullData : idMap[id];
-}
\ No newline at end of file
@@ -1,71 +1,125 @@
+#ifndef INPUT_H
+#define INPUT_H
+
 #include <vector>
+#include <chrono>
+#include <array>
+#include <bitset>
+#include <string>
 #include <unordered_map>
-#include <unordered_set>
 
 #include <SFML/Graphics.hpp>
 
 class Input {
 public:
-    struct Data {
-        std::unordered_set<sf::Keyboard::Key> keysDown;
-        bool pressed;
-        bool just;
-        
-        Data() : pressed(false), just(false) {}
+    static constexpr int MAX_ACTIONS = 64;
+    typedef std::bitset<MAX_ACTIONS> ActionSet;
+    typedef unsigned char Action; // handle of a mapped input
+    typedef std::chrono::steady_clock Clock;
+    static constexpr Action NONE = MAX_ACTIONS - 1; // handle of unmapped inputs (never pressed)
 
-        void tick() {
-            just = false;
+    // state of all actions during a tick (trivially copyable)
+    struct Snapshot {
+        ActionSet pressed;
+        ActionSet justPressed;
+        ActionSet justReleased;
+
+        bool operator==(const Snapshot& other) const {
+            return pressed == other.pressed && justPressed == other.justPressed && justReleased == other.justReleased;
         }
 
-        void update(sf::Keyboard::Key key, bool newPressedState) {
-            if (newPressedState) {
-                keysDown.insert(key);
-            }
-            else {
-                keysDown.erase(key);
-            }
-            bool newPressed = keysDown.size() != 0;
-            just = newPressed != pressed;
-            pressed = newPressed;
+        bool operator!=(const Snapshot& other) const {
+            return !(*this == other);
         }
     };
-private:
-    static std::unordered_map<std::string, Data> idMap;
-    static std::unordered_map<sf::Keyboard::Key, Data*> keyMap;
-    static std::vector<std::pair<sf::Keyboard::Key, bool>> events;
-    static Data nullData;
 
-    static Data& get(std::string id);
+    // timestamped key event
+    struct Event {
+        sf::Keyboard::Key key;
+        bool pressed;
+        Clock::time_point time; // when the event was sampled
+
+        Event(sf::Keyboard::Key key, bool pressed, Clock::time_point time) : key(key), pressed(pressed), time(time) {}
+    };
+private:
+    static std::unordered_map<std::string, Action> actionIds;
+    static std::array<Action, sf::Keyboard::KeyCount> keyActions; // action of each key (NONE if unmapped)
+    static std::bitset<sf::Keyboard::KeyCount> keysDown;
+    static unsigned char actionKeysDown[MAX_ACTIONS]; // number of mapped keys held per action
+    static std::vector<Event> events; // pending events
+    static std::vector<Event> tickEventList; // events applied on the last tick
+    static Snapshot state;
 public:
-    static void inputEvent(sf::Keyboard::Key key, bool pressed) {
-        events.emplace_back(key, pressed);
+    static void inputEvent(sf::Keyboard::Key key, bool pressed, Clock::time_point time = Clock::now()) {
+        events.emplace_back(key, pressed, time);
     }
 
-    // advance state by a tick
+    // advance state by a tick (pending events applied in timestamp order)
     static void inputTick();
 
-    // maps a key to an input (note: only one input per key allowed)
-    static void mapInput(sf::Keyboard::Key key, std::string id);
+    // events applied on the last tick in timestamp order
+    static const std::vector<Event>& tickEvents() {
+        return tickEventList;
+    }
+
+    // maps a key to an input and returns its handle (note: only one input per key allowed)
+    static Action mapInput(sf::Keyboard::Key key, const std::string& id);
+
+    // handle of an input (NONE if never mapped)
+    static Action action(const std::string& id) {
+        auto it = actionIds.find(id);
+        return it == actionIds.end() ? NONE : it->second;
+    }
+
+    // state of the current tick
+    static const Snapshot& snapshot() {
+        return state;
+    }
 
-    static bool isPressed(std::string id) {
-        return get(id).pressed;
+    // overwrite state of the current tick (e.g. when replaying)
+    static void setSnapshot(const Snapshot& snapshot) {
+        state = snapshot;
     }
 
-    static bool isReleased(std::string id) {
-        return !get(id).pressed;
+    static bool isPressed(Action a) {
+        return state.pressed[a];
     }
 
-    static bool justPressed(std::string id) {
-        Data& data = get(id);
-        return data.pressed && data.just;
+    static bool isReleased(Action a) {
+        return !state.pressed[a];
     }
 
-    static bool justReleased(std::string id) {
-        Data& data = get(id);
-        return !data.pressed && data.just;
+    static bool justPressed(Action a) {
+        return state.justPressed[a];
     }
 
-    static bool justChanged(std::string id) {
-        return get(id).just;
+    static bool justReleased(Action a) {
+        return state.justReleased[a];
     }
-};
\ No newline at end of file
+
+    static bool justChanged(Action a) {
+        return state.justPressed[a] || state.justReleased[a];
+    }
+
+    static bool isPressed(const std::string& id) {
+        return isPressed(action(id));
+    }
+
+    static bool isReleased(const std::string& id) {
+        return isReleased(action(id));
+    }
+
+    static bool justPressed(const std::string& id) {
+        return justPressed(action(id));
+    }
+
+    static bool justReleased(const std::string& id) {
+        return justReleased(action(id));
+    }
+
+    static bool justChanged(const std::string& id) {
+        return justChanged(action(id));
+    }
+};
+
+#endif
@@ -0,0 +1,272 @@
+# include "./lasers.h"
+# include "./profiler.h"
+
+# include <algorithm>
+# include <cmath>
+
+const int StraightLaser::GROW_TIME = 8;
+const float StraightLaser::WARN_WIDTH = 0.1f;
+const int CurvyLaser::TAPER = 4;
+const float Lasers::HIT_RADIUS = 0.3f;
+
+std::vector<std::shared_ptr<StraightLaser>> StraightLaser::lasers = std::vector<std::shared_ptr<StraightLaser>>();
+std::vector<std::shared_ptr<CurvyLaser>> CurvyLaser::lasers = std::vector<std::shared_ptr<CurvyLaser>>();
+std::function<void(sf::Vector2f)> Lasers::onHit = nullptr;
+long long Lasers::hitTicks = 0;
+float Lasers::leftX = NAN;
+float Lasers::rightX = NAN;
+float Lasers::topY = NAN;
+float Lasers::bottomY = NAN;
+
+// core ribbon width as a fraction of the glow
+static const float CORE_WIDTH = 0.35f;
+
+// glow ribbon followed by the core ribbon over a polyline (a vertex pair per point, offset along the point's normal by
+// the half width times widths[i]), the repeated vertices between them make zero area triangles
+// both ribbons are filled in one pass and resize() keeps the vertex capacity, so rebuilding every tick doesn't allocate
+static void buildStrip(sf::VertexArray& strip, const sf::Vector2f* points, const float* widths, std::size_t count, float width, sf::Color color) {
+    if (count < 2) {
+        strip.clear();
+        return;
+    }
+    strip.resize(count * 4 + 2);
+    std::size_t core = count * 2 + 2;
+    sf::Color coreColor(255, 255, 255, color.a);
+    sf::Vector2f normal(0, 1);
+    for (std::size_t i = 0; i < count; ++i) {
+        sf::Vector2f tangent = points[std::min(i + 1, count - 1)] - points[i == 0 ? 0 : i - 1];
+        float len = std::sqrt(tangent.x * tangent.x + tangent.y * tangent.y);
+        if (len > 1e-4f) normal = sf::Vector2f(-tangent.y / len, tangent.x / len); // repeated points keep the last normal
+        sf::Vector2f offset = normal * (width * 0.5f * widths[i]);
+        strip[i * 2] = sf::Vertex(points[i] + offset, color);
+        strip[i * 2 + 1] = sf::Vertex(points[i] - offset, color);
+        offset *= CORE_WIDTH;
+        strip[core + i * 2] = sf::Vertex(points[i] + offset, coreColor);
+        strip[core + i * 2 + 1] = sf::Vertex(points[i] - offset, coreColor);
+    }
+    strip[core - 2] = strip[core - 3];
+    strip[core - 1] = strip[core];
+}
+
+bool Lasers::touches(sf::Vector2f a, sf::Vector2f b, float radius) {
+    sf::Vector2f ab = b - a;
+    sf::Vector2f ap = Player::pos - a;
+    float lenSqd = ab.x * ab.x + ab.y * ab.y;
+    float t = lenSqd > 0 ? std::min(std::max((ap.x * ab.x + ap.y * ab.y) / lenSqd, 0.f), 1.f) : 0.f;
+    sf::Vector2f d = ap - ab * t;
+    return d.x * d.x + d.y * d.y <= radius * radius;
+}
+
+void Lasers::moveTick() {
+    PROFILE_ZONE("Lasers::moveTick");
+    for (const std::shared_ptr<StraightLaser>& laser : StraightLaser::lasers)
+        laser->tick();
+    for (const std::shared_ptr<CurvyLaser>& laser : CurvyLaser::lasers)
+        laser->tick();
+
+    StraightLaser::lasers.erase(std::remove_if(StraightLaser::lasers.begin(), StraightLaser::lasers.end(),
+        [](const std::shared_ptr<StraightLaser>& laser) { return laser->remove; }), StraightLaser::lasers.end());
+    CurvyLaser::lasers.erase(std::remove_if(CurvyLaser::lasers.begin(), CurvyLaser::lasers.end(),
+        [](const std::shared_ptr<CurvyLaser>& laser) { return laser->remove; }), CurvyLaser::lasers.end());
+}
+
+// draws every laser's strip (one draw call per laser)
+class LaserLayer : public Node {
+public:
+    virtual void draw(Renderer& target, const sf::Transform& parentTrans, int calcTick) override {
+        drawStats.visited++;
+        sf::RenderStates states(parentTrans * tf.getTransform());
+        for (const std::shared_ptr<StraightLaser>& laser : StraightLaser::lasers) {
+            const sf::VertexArray& strip = laser->getStrip();
+            if (strip.getVertexCount() != 0) target.draw(&strip[0], strip.getVertexCount(), sf::TriangleStrip, states);
+        }
+        for (const std::shared_ptr<CurvyLaser>& laser : CurvyLaser::lasers) {
+            const sf::VertexArray& strip = laser->getStrip();
+            if (strip.getVertexCount() != 0) target.draw(&strip[0], strip.getVertexCount(), sf::TriangleStrip, states);
+        }
+        drawChildren(target, states.transform, calcTick);
+    }
+};
+
+std::shared_ptr<Node> Lasers::rootNode = std::make_shared<LaserLayer>();
+
+StraightLaser::StraightLaser(sf::Color color, float x, float y, float dir, float maxLength, float width, int warnTime, int activeTime, float extendSpeed, float rotSpeed) : strip(sf::TriangleStrip), remove(false), time(0), color(color), x(x), y(y), dir(dir), rotSpeed(rotSpeed), length(0), maxLength(maxLength), extendSpeed(extendSpeed), width(width), widthScale(WARN_WIDTH), warnTime(warnTime), activeTime(activeTime) {}
+
+std::shared_ptr<StraightLaser> StraightLaser::create(sf::Color color, float x, float y, float dir, float maxLength, float width, int warnTime, int activeTime, float extendSpeed, float rotSpeed) {
+    lasers.push_back(makePooled<StraightLaser>(color, x, y, dir, maxLength, width, warnTime, activeTime, extendSpeed, rotSpeed));
+    return lasers.back();
+}
+
+void StraightLaser::tick() {
+    if (remove) return;
+    dir += rotSpeed;
+    length = extendSpeed > 0 ? std::min(length + extendSpeed, maxLength) : maxLength;
+
+    // width animation
+    int t = time - warnTime;
+    if (t < 0) widthScale = WARN_WIDTH;
+    else if (t < GROW_TIME) widthScale = WARN_WIDTH + (1 - WARN_WIDTH) * t / GROW_TIME;
+    else if (t < GROW_TIME + activeTime) widthScale = 1;
+    else widthScale = std::max(1 - (float)(t - GROW_TIME - activeTime) / GROW_TIME, 0.f);
+
+    // collisions
+    if (active()) {
+        sf::Vector2f origin(x, y);
+        if (Lasers::touches(origin, origin + sf::Vector2f(std::cos(dir), std::sin(dir)) * length, width * Lasers::HIT_RADIUS))
+            Lasers::hit();
+    }
+
+    rebuild();
+
+    // update time
+    time++;
+    if (time >= warnTime + 2 * GROW_TIME + activeTime) remove = true;
+}
+
+void StraightLaser::rebuild() {
+    sf::Vector2f axis(std::cos(dir), std::sin(dir));
+    sf::Vector2f origin(x, y);
+    float halfWidth = width * widthScale * 0.5f;
+
+    // pointed caps stick out by half the width (about the round caps of the capsule it collides as)
+    sf::Vector2f points[4] = { origin - axis * halfWidth, origin, origin + axis * length, origin + axis * (length + halfWidth) };
+    static const float widths[4] = { 0, 1, 1, 0 };
+    sf::Color drawColor = color;
+    if (time < warnTime) drawColor.a /= 2;
+    buildStrip(strip, points, widths, 4, width * widthScale, drawColor);
+}
+
+void StraightLaser::saveState(SnapshotWriter& out) {
+    out.write(remove);
+    out.write(time);
+    out.write(color);
+    out.write(x);
+    out.write(y);
+    out.write(dir);
+    out.write(rotSpeed);
+    out.write(length);
+    out.write(maxLength);
+    out.write(extendSpeed);
+    out.write(width);
+    out.write(widthScale);
+    out.write(warnTime);
+    out.write(activeTime);
+}
+
+void StraightLaser::loadState(SnapshotReader& in) {
+    in.read(remove);
+    in.read(time);
+    in.read(color);
+    in.read(x);
+    in.read(y);
+    in.read(dir);
+    in.read(rotSpeed);
+    in.read(length);
+    in.read(maxLength);
+    in.read(extendSpeed);
+    in.read(width);
+    in.read(widthScale);
+    in.read(warnTime);
+    in.read(activeTime);
+    rebuild();
+}
+
+CurvyLaser::CurvyLaser(sf::Color color, float x, float y, float dir, float speed, float turn, float width, int length, int lifetime) : trail(std::max(length, 2)), newest(0), count(1), path(trail.size()), widths(trail.size()), strip(sf::TriangleStrip), remove(false), time(0), color(color), x(x), y(y), dir(dir), speed(speed), turn(turn), width(width), lifetime(lifetime) {
+    trail[0] = sf::Vector2f(x, y);
+    rebuild();
+}
+
+std::shared_ptr<CurvyLaser> CurvyLaser::create(sf::Color color, float x, float y, float dir, float speed, float turn, float width, int length, int lifetime) {
+    lasers.push_back(makePooled<CurvyLaser>(color, x, y, dir, speed, turn, width, length, lifetime));
+    return lasers.back();
+}
+
+void CurvyLaser::tick() {
+    if (remove) return;
+    int capacity = (int)trail.size();
+
+    // move the head (overwriting the oldest point once full), or drain the tail into the stopped head
+    if (time < lifetime) {
+        dir += turn;
+        x += std::cos(dir) * speed;
+        y += std::sin(dir) * speed;
+        newest = (newest + 1) % capacity;
+        trail[newest] = sf::Vector2f(x, y);
+        if (count < capacity) count++;
+    } else {
+        count--;
+    }
+
+    rebuild();
+
+    // collisions (bounds first, then the segments)
+    float r = width * Lasers::HIT_RADIUS;
+    sf::FloatRect hitBounds(bounds.left - r, bounds.top - r, bounds.width + 2 * r, bounds.height + 2 * r);
+    if (hitBounds.contains(Player::pos)) {
+        for (int i = 0; i + 1 < count; ++i) {
+            if (Lasers::touches(path[i], path[i + 1], r)) {
+                Lasers::hit();
+                break;
+            }
+        }
+    }
+
+    // update time
+    time++;
+    if (count < 2 || Lasers::offScreen(bounds)) remove = true;
+}
+
+void CurvyLaser::rebuild() {
+    int capacity = (int)trail.size();
+    sf::Vector2f low = trail[newest];
+    sf::Vector2f high = low;
+    for (int i = 0; i < count; ++i) {
+        sf::Vector2f p = trail[(newest - i + capacity) % capacity];
+        path[i] = p;
+        widths[i] = std::min(std::min(1.f, (float)(i + 1) / TAPER), (float)(count - i) / TAPER);
+        low.x = std::min(low.x, p.x);
+        low.y = std::min(low.y, p.y);
+        high.x = std::max(high.x, p.x);
+        high.y = std::max(high.y, p.y);
+    }
+    float margin = width * 0.5f;
+    bounds = sf::FloatRect(low.x - margin, low.y - margin, high.x - low.x + 2 * margin, high.y - low.y + 2 * margin);
+    buildStrip(strip, path.data(), widths.data(), count, width, color);
+}
+
+void CurvyLaser::saveState(SnapshotWriter& out) {
+    out.write(remove);
+    out.write(time);
+    out.write(color);
+    out.write(x);
+    out.write(y);
+    out.write(dir);
+    out.write(speed);
+    out.write(turn);
+    out.write(width);
+    out.write(lifetime);
+    out.write(newest);
+    out.write(count);
+    int capacity = (int)trail.size();
+    for (int i = 0; i < count; ++i)
+        out.write(trail[(newest - i + capacity) % capacity]);
+}
+
+void CurvyLaser::loadState(SnapshotReader& in) {
+    in.read(remove);
+    in.read(time);
+    in.read(color);
+    in.read(x);
+    in.read(y);
+    in.read(dir);
+    in.read(speed);
+    in.read(turn);
+    in.read(width);
+    in.read(lifetime);
+    in.read(newest);
+    in.read(count);
+    int capacity = (int)trail.size();
+    for (int i = 0; i < count; ++i)
+        in.read(trail[(newest - i + capacity) % capacity]);
+    rebuild();
+}
@@ -0,0 +1,152 @@
+# ifndef LASERS_H
+# define LASERS_H
+
+# include "./scenegraph.h"
+# include "./player.h"
+# include "./snapshot.h"
+
+# include <SFML/Graphics.hpp>
+# include <functional>
+# include <memory>
+# include <vector>
+
+// lasers are single objects (no bullets or nodes per segment): each is rebuilt every tick into one triangle strip
+// (a glow ribbon and a thinner core ribbon joined by degenerate triangles, so one draw call) and collides with
+// the player as capsules around its center line
+
+// laser from a fixed origin: warning line, then grows to full width, stays for a while and shrinks away
+class StraightLaser {
+private:
+    static const int GROW_TIME; // ticks to grow from the warning width to full width (and to shrink back)
+    static const float WARN_WIDTH; // fraction of the width while warning
+
+    sf::VertexArray strip;
+
+    void rebuild();
+public:
+    static std::vector<std::shared_ptr<StraightLaser>> lasers;
+
+    bool remove;
+    int time;
+    sf::Color color;
+    float x, y; // origin
+    float dir, rotSpeed; // radians, radians per tick
+    float length, maxLength, extendSpeed; // current length grows by extendSpeed per tick (0: full length at once)
+    float width; // full width
+    float widthScale; // current fraction of the width
+    int warnTime; // ticks of warning (no collision)
+    int activeTime; // ticks at full width
+
+    StraightLaser(sf::Color color, float x, float y, float dir, float maxLength, float width, int warnTime, int activeTime, float extendSpeed, float rotSpeed);
+
+    static std::shared_ptr<StraightLaser> create(sf::Color color, float x, float y, float dir, float maxLength, float width, int warnTime, int activeTime, float extendSpeed = 0, float rotSpeed = 0);
+
+    // collides with the player (fully grown and not shrinking)
+    bool active() const {
+        return time >= warnTime + GROW_TIME && time < warnTime + GROW_TIME + activeTime;
+    }
+
+    // advance, collide and rebuild the strip
+    void tick();
+
+    const sf::VertexArray& getStrip() const {
+        return strip;
+    }
+
+    void saveState(SnapshotWriter& out);
+    void loadState(SnapshotReader& in);
+};
+
+// laser following a moving head: the head's last positions are kept in a fixed size ring buffer and the ribbon
+// runs through them, so the body bends along the path the head took
+// once its lifetime is over the head stops and the tail drains into it
+class CurvyLaser {
+private:
+    static const int TAPER; // points over which the ends narrow
+
+    std::vector<sf::Vector2f> trail; // ring buffer of head positions (capacity fixed at creation)
+    int newest;
+    int count;
+    std::vector<sf::Vector2f> path; // trail from head to tail (scratch for building)
+    std::vector<float> widths;
+    sf::VertexArray strip;
+    sf::FloatRect bounds; // of the trail
+
+    void rebuild();
+public:
+    static std::vector<std::shared_ptr<CurvyLaser>> lasers;
+
+    bool remove;
+    int time;
+    sf::Color color;
+    float x, y; // head
+    float dir, speed, turn; // radians, pixels per tick, radians per tick
+    float width;
+    int lifetime; // ticks the head moves
+
+    CurvyLaser(sf::Color color, float x, float y, float dir, float speed, float turn, float width, int length, int lifetime);
+
+    // length is the trail size in points (one per tick)
+    static std::shared_ptr<CurvyLaser> create(sf::Color color, float x, float y, float dir, float speed, float turn, float width, int length, int lifetime);
+
+    // advance, collide and rebuild the strip
+    void tick();
+
+    const sf::VertexArray& getStrip() const {
+        return strip;
+    }
+
+    int size() const {
+        return count;
+    }
+
+    void saveState(SnapshotWriter& out);
+    void loadState(SnapshotReader& in);
+};
+
+// shared laser state: draw layer, play area and hit hook
+class Lasers {
+private:
+    static float leftX, rightX, topY, bottomY;
+public:
+    static const float HIT_RADIUS; // collision radius as a fraction of the width (between the core and the glow)
+
+    static std::shared_ptr<Node> rootNode; // draws every laser
+    static std::function<void(sf::Vector2f)> onHit; // called for every hit (with the player position)
+    static long long hitTicks; // laser hits since start (one per laser per tick)
+
+    static void init(float leftX, float rightX, float topY, float bottomY) {
+        Lasers::leftX = leftX;
+        Lasers::rightX = rightX;
+        Lasers::topY = topY;
+        Lasers::bottomY = bottomY;
+    }
+
+    // tick every laser and drop finished ones
+    static void moveTick();
+
+    // whether a rect is completely outside of the play area
+    static bool offScreen(const sf::FloatRect& rect) {
+        return rect.left + rect.width < leftX || rect.left > rightX || rect.top + rect.height < topY || rect.top > bottomY;
+    }
+
+    // whether the player is within radius of segment ab
+    static bool touches(sf::Vector2f a, sf::Vector2f b, float radius);
+
+    // the player is inside a laser this tick (at most once per laser)
+    static void hit() {
+        hitTicks++;
+        if (onHit) onHit(Player::pos);
+    }
+
+    static int count() {
+        return (int)(StraightLaser::lasers.size() + CurvyLaser::lasers.size());
+    }
+
+    static void clear() {
+        StraightLaser::lasers.clear();
+        CurvyLaser::lasers.clear();
+    }
+};
+
+# endif
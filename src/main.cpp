@@ -8,68 +8,264 @@
 #include <chrono>
 #include <iostream>
 #include <filesystem>
-#include <random>
+#include <fstream>
 
 #include <cmath>
+#include <cstdio>
 
 #include "./input.h"
-#include "./audio.cpp"
+#include "./audio.h"
 #include "./scenegraph.h"
 #include "./bullets.h"
 #include "./bulletscript.h"
+#include "./lasers.h"
+#include "./particles.h"
+#include "./profiler.h"
+#include "./overlay.h"
+#include "./alloctracker.h"
+#include "./framepacer.h"
+#include "./telemetry.h"
+#include "./rng.h"
+#include "./replay.h"
+#include "./snapshot.h"
+#include "./pool.h"
+#include "./quality.h"
+#include "./timeline.h"
 
 #define DEBUG_TIMER true
+#define LATE_INPUT_SAMPLING true // wait for the frame slot before reading input (instead of after display)
 
 #if DEBUG_TIMER
-// execution time tracker
+// execution time tracker (fixed ring of recent times, no allocation per record)
 class ExecTimer {
 private:
     std::chrono::high_resolution_clock::time_point startTime;
-    std::list<float> times;
+    std::vector<long long> times;
+    int next; // ring position
+    int count;
     const int trials;
     long long trialSum;
 public:
     const std::string label;
-    ExecTimer(std::string label, int trials) : label(label), trials(trials), trialSum(0) {}
+    ExecTimer(std::string label, int trials) : label(label), times(trials), next(0), count(0), trials(trials), trialSum(0) {}
 
     void start() {
         startTime = std::chrono::high_resolution_clock::now();
     }
 
     void record() {
-        times.push_back((std::chrono::high_resolution_clock::now() - startTime).count());
-        trialSum += times.back();
-        if (times.size() > trials) {
-            trialSum -= times.front();
-            times.pop_front();
-        }
+        long long time = (std::chrono::high_resolution_clock::now() - startTime).count();
+        if (count == trials) trialSum -= times[next];
+        else count++;
+        times[next] = time;
+        trialSum += time;
+        next = (next + 1) % trials;
     }
 
     long long getAvg() {
         return trialSum / trials;
     }
 
+    // last recorded time (ns)
+    long long getLast() {
+        return count == 0 ? 0 : times[(next + trials - 1) % trials];
+    }
+
     std::string log() {
-        return label + ": " + (trials == times.size() ? std::to_string(getAvg()/1000)  : "<not enough trials>") + "us";
+        return label + ": " + (trials == count ? std::to_string(getAvg()/1000)  : "<not enough trials>") + "us";
+    }
+};
+
+// input to display latency tracker (frames without input events are skipped)
+class LatencyTracker {
+private:
+    long long sum;
+    long long max;
+    int count;
+public:
+    LatencyTracker() : sum(0), max(0), count(0) {}
+
+    void record(std::chrono::nanoseconds latency) {
+        sum += latency.count();
+        max = std::max<long long>(max, latency.count());
+        count++;
+    }
+
+    // log and reset
+    std::string log() {
+        std::string s = "input latency: " + (count == 0 ? "<no input>" : std::to_string(sum / count / 1000) + "us (max " + std::to_string(max / 1000) + "us)");
+        sum = max = count = 0;
+        return s;
     }
 };
 #endif
 
 float randDir() {
-    static std::default_random_engine e;
-    static std::uniform_real_distribution<> randDir(0, M_PI * 2);
-    return randDir(e);
+    return Rng::game.uniform(0, M_PI * 2);
 }
 
-int main() {
-    // setup window
+int main(int argc, char** argv) {
     const int FPS = 60;
-    sf::RenderWindow window = sf::RenderWindow{ { 1280, 960 }, "CMake SFML Project" };
-    window.setFramerateLimit(FPS);
+    PROFILE_THREAD("main");
+
+    // render a scripted audio sequence to a wav file (no window or audio device needed)
+    if (argc == 3 && std::string(argv[1]) == "--render-audio") {
+        SoundEffect s("resources/audio/sound/seUseSpellCard.wav");
+        MusicTrack m("resources/audio/music/IntoTheAbyssStart.ogg", "resources/audio/music/IntoTheAbyssLoop.ogg");
+        return Mixer::renderOffline(argv[2], FPS * 30, FPS, [&](int tick) {
+            if (tick == 0) m.play();
+            if (tick % (FPS * 2) == FPS) s.play();
+            }) ? 0 : 1;
+    }
+
+    // options
+    std::string tracePath; // write a chrome trace of the last frames on exit
+    int headlessTicks = 0; // run this many ticks without window, drawing or audio device
+    int allocWarmup = -1; // fail if any tick after this many allocates
+    std::string telemetryPath; // per frame records (.csv or .jsonl)
+    long long telemetryRotate = 0; // records per telemetry file (0 for one file)
+    std::string drawDumpPath; // headless only: write the draws of the last frame
+    unsigned long long seed = 1; // simulation rng seed
+    std::string recordPath; // save a replay of this run
+    std::string replayPath; // play back a replay instead of reading input
+    bool fastForward = false; // play back headless as fast as possible
+    int rewindSeconds = 0; // practice mode: keep this much history to rewind through while backspace is held
+    float renderScale = 1; // scene resolution as a fraction of the window (the overlay stays at full resolution)
+    sf::Vector2u renderSize; // fixed scene resolution instead of a fraction (e.g. 640x480)
+    bool renderSmooth = true; // linear filtering when stretching a reduced resolution scene, nearest otherwise
+    std::string quality = "auto"; // quality tier or auto (adapts to frame time, headless runs stay at high)
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--trace") tracePath = argv[i + 1];
+        else if (option == "--headless") headlessTicks = std::stoi(argv[i + 1]);
+        else if (option == "--assert-no-alloc") allocWarmup = std::stoi(argv[i + 1]);
+        else if (option == "--telemetry") telemetryPath = argv[i + 1];
+        else if (option == "--telemetry-rotate") telemetryRotate = std::stoll(argv[i + 1]);
+        else if (option == "--dump-draws") drawDumpPath = argv[i + 1];
+        else if (option == "--seed") seed = std::stoull(argv[i + 1]);
+        else if (option == "--record") recordPath = argv[i + 1];
+        else if (option == "--rewind") rewindSeconds = std::stoi(argv[i + 1]);
+        else if (option == "--replay") replayPath = argv[i + 1];
+        else if (option == "--quality") quality = argv[i + 1];
+        else if (option == "--render-scale") renderScale = std::stof(argv[i + 1]);
+        else if (option == "--render-size") std::sscanf(argv[i + 1], "%ux%u", &renderSize.x, &renderSize.y);
+        else if (option == "--render-filter") renderSmooth = std::string(argv[i + 1]) != "nearest";
+        else if (option == "--fast-forward") {
+            replayPath = argv[i + 1];
+            fastForward = true;
+        }
+    }
+
+    // replays bring their own seed (fast forward runs every recorded tick unless --headless stops earlier)
+    Replay replay;
+    if (!replayPath.empty()) {
+        if (!replay.load(replayPath)) {
+            std::cerr << "cannot read replay " << replayPath << std::endl;
+            return 1;
+        }
+        seed = replay.getSeed();
+        if (fastForward) headlessTicks = headlessTicks > 0 ? std::min<int>(headlessTicks, replay.getTicks()) : replay.getTicks();
+    } else if (!recordPath.empty()) {
+        replay.begin(seed);
+    }
+    Rng::game.reseed(seed);
+    const bool headless = headlessTicks > 0;
+
+    // quality governor (only changes what is drawn, the simulation runs the same at every tier)
+    QualityGovernor governor(1000.f / FPS);
+    if (quality != "auto") {
+        int tier = QualityGovernor::parse(quality.c_str());
+        if (tier < 0) {
+            std::cerr << "unknown quality " << quality << std::endl;
+            return 1;
+        }
+        governor.setTier((QualityGovernor::Tier)tier);
+    } else if (headless) {
+        // draw dumps and telemetry of headless runs should not depend on the machine's speed
+        governor.setTier(QualityGovernor::high);
+    }
+
+    // setup window
+    const sf::Vector2u windowSize(1280, 960);
+    sf::RenderWindow window;
+    if (!headless) window.create(sf::VideoMode(windowSize.x, windowSize.y), "CMake SFML Project");
     window.setKeyRepeatEnabled(false);
 
-    // setup scene
-    SceneGraph sceneGraph(window);
+    // frames are paced by the game loop (setFramerateLimit only sleeps, which jitters by the os timer granularity)
+    FramePacer pacer(std::chrono::nanoseconds(1000000000 / FPS));
+    if (!headless) {
+        // lock to the display if its refresh is close to the frame rate (e.g. 59.94hz), so frames don't drift against it
+        window.setVerticalSyncEnabled(true);
+        std::chrono::nanoseconds refresh = FramePacer::measureRefresh([&window]() { window.display(); }, 30);
+        window.setVerticalSyncEnabled(false);
+        if (pacer.adaptToRefresh(refresh))
+            printf("frame period locked to display refresh: %lldus\n", (long long)pacer.getPeriod().count() / 1000);
+    }
+#if LATE_INPUT_SAMPLING
+    std::chrono::nanoseconds workEstimate(0); // smoothed time from sampling input to display
+#endif
+
+    // read window events (key events stamped with the time they were read)
+    auto pollInput = [&window]() {
+        for (auto event = sf::Event{}; window.pollEvent(event);)
+        {
+            switch (event.type) {
+            case sf::Event::Closed:
+                window.close();
+                break;
+            case sf::Event::KeyPressed:
+                Input::inputEvent(event.key.code, true, Input::Clock::now());
+                break;
+            case sf::Event::KeyReleased:
+                Input::inputEvent(event.key.code, false, Input::Clock::now());
+                break;
+            }
+        }
+    };
+
+    // setup inputs
+    const Input::Action upInput = Input::mapInput(sf::Keyboard::W, "up");
+    const Input::Action leftInput = Input::mapInput(sf::Keyboard::A, "left");
+    const Input::Action downInput = Input::mapInput(sf::Keyboard::S, "down");
+    const Input::Action rightInput = Input::mapInput(sf::Keyboard::D, "right");
+    Input::mapInput(sf::Keyboard::Up, "up");
+    Input::mapInput(sf::Keyboard::Left, "left");
+    Input::mapInput(sf::Keyboard::Down, "down");
+    Input::mapInput(sf::Keyboard::Right, "right");
+    const Input::Action chargeInput = Input::mapInput(sf::Keyboard::Space, "charge");
+    Input::mapInput(sf::Keyboard::LShift, "charge");
+    const Input::Action rewindInput = Input::mapInput(sf::Keyboard::Backspace, "rewind");
+#if DEBUG_TIMER
+    const Input::Action overlayInput = Input::mapInput(sf::Keyboard::F3, "overlay");
+#endif
+
+    // setup scene (headless runs the draw path through a renderer that only counts)
+    SFMLRenderer windowRenderer(window);
+    RecordingRenderer headlessRenderer(windowSize, !drawDumpPath.empty());
+    SceneGraph sceneGraph(headless ? (Renderer&)headlessRenderer : windowRenderer);
+
+    // reduced resolution scene (fill rate scales with the pixel count)
+    OffscreenRenderer offscreenRenderer(windowRenderer);
+    if (renderSize.x == 0 || renderSize.y == 0)
+        renderSize = sf::Vector2u((unsigned int)std::round(windowSize.x * renderScale), (unsigned int)std::round(windowSize.y * renderScale));
+    if (!headless && renderSize != windowSize && renderSize.x != 0 && renderSize.y != 0) {
+        if (offscreenRenderer.create(renderSize, renderSmooth)) {
+            sceneGraph.offscreen = &offscreenRenderer;
+            printf("scene rendered at %ux%u\n", renderSize.x, renderSize.y);
+        } else {
+            std::cerr << "cannot create " << renderSize.x << 'x' << renderSize.y << " render texture, drawing at full resolution" << std::endl;
+        }
+    }
+
+    // create background
+    std::shared_ptr<ParticleSystem> starField = ParticleSystem::create(4096);
+    int starStyle = starField->addStyle(ParticleStyle(
+        Curve<sf::Color>({ { 0.f, sf::Color::Transparent }, { 0.05f, sf::Color(200, 200, 255) }, { 0.9f, sf::Color(200, 200, 255) }, { 1.f, sf::Color::Transparent } }),
+        Curve<float>(1.5f),
+        1000));
+    starField->addEmitter(ParticleSystem::Emitter(starStyle, sf::FloatRect(0, -10, windowSize.x, 10), 0.5f, M_PI * 0.45f, M_PI * 0.55f, 1.f, 3.f, sf::Color::White));
+    starField->prewarm(1000);
+    sceneGraph.root->addChild(starField);
 
     std::shared_ptr<DrawableNode> playerSprite = DrawableNode::create();
     std::shared_ptr<ArraySprite> playerBase = ArraySprite::create({ "resources/graphics/NuvenMove.png", "resources/graphics/NuvenCharge.png" });
@@ -77,23 +273,23 @@ int main() {
     sf::CircleShape orb;
     orb.setFillColor(sf::Color::White);
     
-    std::shared_ptr<DrawableNode> playerOrb = DrawableNode::create([&orb](sf::RenderTarget& renderTarget, sf::Transform& trans, int ticks) {
+    std::shared_ptr<DrawableNode> playerOrb = DrawableNode::create([&orb, chargeInput](Renderer& renderer, const sf::Transform& trans, int ticks) {
         float radius = Player::charge * 20.f * (1 + 0.1f * std::sin(ticks * M_PI / 3.f));
         orb.setOutlineColor(Player::charge == 1? sf::Color::Red : sf::Color::Yellow);
-        if (Input::isPressed("charge")) {
+        if (Input::isPressed(chargeInput)) {
             orb.setRadius(radius * 0.75f);
             orb.setOutlineThickness(radius * 0.25f);
             orb.setOrigin(orb.getRadius(), orb.getRadius());
             orb.setPosition(0, -40);
-            renderTarget.draw(orb, trans);
+            renderer.draw(orb, trans);
         } else {
             orb.setRadius(radius * 0.375f);
             orb.setOutlineThickness(radius * 0.125f);
             orb.setOrigin(orb.getRadius(), orb.getRadius());
             orb.setPosition(-12, 11);
-            renderTarget.draw(orb, trans);
+            renderer.draw(orb, trans);
             orb.setPosition(12, 11);
-            renderTarget.draw(orb, trans);
+            renderer.draw(orb, trans);
         }
         });
     playerBase->tf.setOrigin(32, 36);
@@ -104,9 +300,43 @@ int main() {
     playerSprite->addChild(playerBase);
     playerSprite->tf.setScale(2.0f, 2.0f);
 
+    // lasers are drawn under the bullets (same space)
+    sceneGraph.root->addChild(Lasers::rootNode);
+    Lasers::init(windowSize.x * -0.5f, windowSize.x * 0.5f, windowSize.y * -0.5f, windowSize.y * 0.5f);
+    Lasers::rootNode->tf.setPosition(windowSize.x * 0.5f, windowSize.y * 0.5f);
+
     sceneGraph.root->addChild(Bullet::rootNode);
-    Bullet::init(window.getSize(), window.getSize().x * -0.5f, window.getSize().x * 0.5f, window.getSize().y * -0.5f, window.getSize().y * 0.5f);
-    Bullet::rootNode->tf.setPosition(window.getSize().x * 0.5f, window.getSize().y * 0.5f);
+    Bullet::init(windowSize, windowSize.x * -0.5f, windowSize.x * 0.5f, windowSize.y * -0.5f, windowSize.y * 0.5f);
+    Bullet::rootNode->tf.setPosition(windowSize.x * 0.5f, windowSize.y * 0.5f);
+
+    // create hit effects (same space as bullets)
+    std::shared_ptr<ParticleSystem> effects = ParticleSystem::create(65536);
+    int sparkStyle = effects->addStyle(ParticleStyle(
+        Curve<sf::Color>({ { 0.f, sf::Color::White }, { 1.f, sf::Color::Transparent } }),
+        Curve<float>({ { 0.f, 3.f }, { 1.f, 0.f } }),
+        30, { 0, 0 }, 0.08f, true));
+    effects->emitOnBulletDeath(sparkStyle, 8, 1.f, 4.f);
+    Lasers::onHit = [&](sf::Vector2f at) {
+        effects->burst(sparkStyle, at.x, at.y, 2, 1.f, 3.f);
+    };
+    effects->tf.setPosition(windowSize.x * 0.5f, windowSize.y * 0.5f);
+    sceneGraph.root->addChild(effects);
+
+#if DEBUG_TIMER
+    // performance overlay (drawn last at full resolution, toggled with F3)
+    std::shared_ptr<PerfOverlay> overlay = PerfOverlay::create(1000.f / FPS);
+    overlay->visible = false;
+    overlay->tf.setPosition(8, 8);
+    sceneGraph.hud->addChild(overlay);
+#endif
+
+    auto applyQuality = [&]() {
+        const QualityGovernor::Settings& settings = governor.getSettings();
+        Bullet::setDetail(settings.bulletOutlines, settings.bulletBackLayer, settings.deathShrink);
+        effects->density = settings.particleDensity;
+        starField->visible = settings.background;
+    };
+    applyQuality();
 
     auto rainbow = [](float t) {
         int r = std::round(255 * std::sin(t * 2.f * M_PI));
@@ -115,30 +345,15 @@ int main() {
         return sf::Color(r, g, b, 255);
     };
     
-    // create background
-    std::shared_ptr<Node> starField = Node::create();
-    sceneGraph.root->addChild(starField);
-
     // setup sounds
     std::unordered_map<std::string, SoundEffect> sounds;
 
     SoundEffect s("resources/audio/sound/seUseSpellCard.wav");
 
     MusicTrack m("resources/audio/music/IntoTheAbyssStart.ogg", "resources/audio/music/IntoTheAbyssLoop.ogg");
+    if (!headless) Mixer::open();
     m.play();
 
-    // setup inputs
-    Input::mapInput(sf::Keyboard::W, "up");
-    Input::mapInput(sf::Keyboard::A, "left");
-    Input::mapInput(sf::Keyboard::S, "down");
-    Input::mapInput(sf::Keyboard::D, "right");
-    Input::mapInput(sf::Keyboard::Up, "up");
-    Input::mapInput(sf::Keyboard::Left, "left");
-    Input::mapInput(sf::Keyboard::Down, "down");
-    Input::mapInput(sf::Keyboard::Right, "right");
-    Input::mapInput(sf::Keyboard::Space, "charge");
-    Input::mapInput(sf::Keyboard::LShift, "charge");
-
     // setup timing
 #if DEBUG_TIMER
     const int TRIALS = FPS;
@@ -146,12 +361,63 @@ int main() {
     ExecTimer calcTimer("calc time", TRIALS);
     ExecTimer drawTimer("draw time", TRIALS);
     ExecTimer frameTimer("frame time", TRIALS);
+    LatencyTracker latencyTracker;
+    long long lastSpawned = 0;
+    long long lastRemoved = 0;
+    unsigned long long lastAudioDrops = 0;
+    if (!telemetryPath.empty() && !Telemetry::open(telemetryPath, Telemetry::formatOf(telemetryPath), telemetryRotate))
+        std::cerr << "cannot write telemetry to " << telemetryPath << std::endl;
+#endif
+
+#if ALLOC_TRACKER
+    // per zone counts at the start and end of a checked tick (reserved up front so snapshots don't allocate)
+    std::vector<AllocTracker::ZoneCounts> allocZones, allocZonesAfter;
+    AllocTracker::zones(allocZones);
+    AllocTracker::zones(allocZonesAfter);
 #endif
 
+    // stage (the script is only a template for the bullets' clones, so it lives in the frame arena)
+    Timeline::stage.every(0, 1, Timeline::FOREVER, [&rainbow](int tick) {
+        BSF::FrameScope frameScripts;
+        std::shared_ptr<BulletScript> bs = BSF::thread({
+        BSF::accel(-0.1f, 3.f , false),
+        BSF::waitUntilOffscreen(),
+        BSF::kill()
+            });
+        for (int i = 0; i < 2; ++i)
+            Bullet::create(Bullet::Type::orb, rainbow(tick / 750.f), 15, 0, -200, randDir(), 5.f, bs);
+        });
+
+    // world state of the last ticks (captured before each simulated tick)
+    SnapshotRing rewindBuffer(std::max(1, rewindSeconds * FPS));
+
     // game loop
     int calcTick = 0;
-    while (window.isOpen())
+    int frames = 0; // differs from calcTick after rewinding
+    const std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
+    while ((headless ? calcTick < headlessTicks : window.isOpen()) && (replayPath.empty() || !replay.finished()))
     {
+        // headless runs as fast as possible
+        if (!headless) {
+            FramePacer::Clock::time_point frameDeadline = pacer.nextDeadline();
+#if LATE_INPUT_SAMPLING
+            // wait until just enough time is left to process and display the frame (reading events meanwhile for accurate timestamps)
+            pacer.waitUntil(frameDeadline - workEstimate - std::chrono::milliseconds(1), pollInput);
+#else
+            pacer.waitUntil(frameDeadline);
+#endif
+        }
+#if LATE_INPUT_SAMPLING
+        Input::Clock::time_point sampled = Input::Clock::now();
+#endif
+
+        PROFILE_ZONE("frame");
+#if ALLOC_TRACKER
+        // zones are only snapshotted when checking
+        const bool checkAllocs = allocWarmup >= 0 && calcTick >= allocWarmup;
+        if (checkAllocs) AllocTracker::zones(allocZones);
+        const unsigned long long allocsBefore = AllocTracker::thread().allocations;
+#endif
 #if DEBUG_TIMER
         frameTimer.start();
 #endif
@@ -161,97 +427,111 @@ int main() {
         inputTimer.start();
 #endif
 
-        // event loop
-        for (auto event = sf::Event{}; window.pollEvent(event);)
         {
-            switch (event.type) {
-            case sf::Event::Closed:
-                window.close();
-                break;
-            case sf::Event::KeyPressed:
-                Input::inputEvent(event.key.code, true);
-                break;
-            case sf::Event::KeyReleased:
-                Input::inputEvent(event.key.code, false);
-                break;
+            PROFILE_ZONE("input");
+
+            // event loop
+            pollInput();
+
+            // update input states
+            Input::inputTick();
+            if (!replayPath.empty()) {
+                Input::Snapshot snapshot;
+                replay.next(snapshot);
+                Input::setSnapshot(snapshot);
+            } else if (!recordPath.empty()) {
+                replay.record(Input::snapshot());
             }
         }
 
-        // update input states
-        Input::inputTick();
-
 #if DEBUG_TIMER 
         inputTimer.record();
 #endif
 
         // CALC STEP
+        const Input::Clock::time_point calcStart = Input::Clock::now();
 #if DEBUG_TIMER
         calcTimer.start();
 #endif
+        PROFILE_ZONE_BEGIN(calcZone, "calc");
         // TODO: add ability to do multiple calc ticks in order to account for draw lag
-        // clean sounds
-        for (auto& kvp : sounds)
-            kvp.second.clean();
-        m.checkLoop();
-
-        // update background
-
-        // spawn bullets
-        std::shared_ptr<BulletScript> bs = BSF::thread({
-        BSF::accel(-0.1f, 3.f , false),
-        BSF::waitUntilOffscreen(),
-        BSF::kill()
-            });
-        for (int i = 0; i < 2; ++i)
-            Bullet::create(Bullet::Type::orb, rainbow(calcTick / 750.f), 15, 0, -200, randDir(), 5.f, bs);
-
+        // release finished sound voices
+        SoundEffect::tick();
+
+        // update background (frozen while hidden)
+        if (starField->visible) starField->tick();
+
+        // practice rewind: while held, step back a captured tick per frame instead of simulating
+        const bool rewinding = rewindSeconds > 0 && Input::isPressed(rewindInput) && rewindBuffer.size() != 0;
+        if (rewinding)
+            calcTick = rewindBuffer.pop() - 1; // state before a tick is the state after the previous one
+        else if (rewindSeconds > 0)
+            rewindBuffer.capture(calcTick);
+
+        if (!rewinding) {
+            // run stage events due this tick
+            Timeline::stage.tick(calcTick);
+
+            // move bullets
+            Bullet::moveTick(calcTick);
+            Lasers::moveTick();
+        }
 
-        // move bullets
-        Bullet::moveTick(calcTick);
+        // update effects
+        effects->tick();
 
         // move player
         sf::Vector2f movement;
-        float speed = Input::isPressed("charge") ? 2.f : 6.f;
-        float tilt = Input::isPressed("charge") ? 0 : 15;
-        if (Input::isPressed("up"))
+        float speed = Input::isPressed(chargeInput) ? 2.f : 6.f;
+        float tilt = Input::isPressed(chargeInput) ? 0 : 15;
+        if (Input::isPressed(upInput))
             movement.y -= 1;
-        if (Input::isPressed("down"))
+        if (Input::isPressed(downInput))
             movement.y += 1;
-        if (Input::isPressed("left"))
+        if (Input::isPressed(leftInput))
             movement.x -= 1;
-        if (Input::isPressed("right"))
+        if (Input::isPressed(rightInput))
             movement.x += 1;
-        Player::pos += movement * speed;
+        if (!rewinding) Player::pos += movement * speed;
         playerBase->tf.setRotation(tilt * movement.x);
-        static sf::Vector2f offset = sf::Vector2f(window.getSize().x * 0.5f, window.getSize().y * 0.5f);
+        static sf::Vector2f offset = sf::Vector2f(windowSize.x * 0.5f, windowSize.y * 0.5f);
         playerSprite->tf.setPosition(Player::pos + offset);
-        playerBase->setIndex(Input::isPressed("charge") ? 1 : 0);
+        playerBase->setIndex(Input::isPressed(chargeInput) ? 1 : 0);
         bool on = Player::charge == 1.f || sin(calcTick * (M_PI/12)) + 1 < Player::charge * 2;
         playerExtra->setIndex((int)on);
         playerExtra->tf.setScale(0.25f + 1.25f * Player::charge, 1.5f);
 
+#if DEBUG_TIMER
+        if (Input::justPressed(overlayInput))
+            overlay->visible = !overlay->visible;
+#endif
+
         // charge
-        if (Input::justReleased("charge") && Player::charge == 1) {
-            s.play();
-            Player::charge = 0;
-        }
-        if (Input::isPressed("charge")) {
-            static float chargeAmount = 1.f / 600.f;
-            Player::charge += chargeAmount;
-            if (Player::charge >= 1.f) Player::charge = 1.f;
-        }
-        else {
-            static float releaseAmount = 1.f / 200.f;
-            Player::charge -= releaseAmount;
-            if (Player::charge < 0.f)
+        if (!rewinding) {
+            if (Input::justReleased(chargeInput) && Player::charge == 1) {
+                s.play();
                 Player::charge = 0;
+            }
+            if (Input::isPressed(chargeInput)) {
+                static float chargeAmount = 1.f / 600.f;
+                Player::charge += chargeAmount;
+                if (Player::charge >= 1.f) Player::charge = 1.f;
+            }
+            else {
+                static float releaseAmount = 1.f / 200.f;
+                Player::charge -= releaseAmount;
+                if (Player::charge < 0.f)
+                    Player::charge = 0;
+            }
         }
+        PROFILE_ZONE_END(calcZone);
 
 #if DEBUG_TIMER
         calcTimer.record();
 #endif
 
         // DRAW STEP
+        const Input::Clock::time_point drawStart = Input::Clock::now();
 #if DEBUG_TIMER
         drawTimer.start();
 #endif
@@ -259,19 +539,112 @@ int main() {
         // draw scenegraph
         sceneGraph.drawTick(calcTick);
 
+        // per tick data is done with
+        const std::size_t arenaUsed = FrameArena::frame.getUsed();
+        FrameArena::frame.reset();
+
+        // adapt quality to the time this frame took (applied from the next frame)
+        const Input::Clock::time_point drawEnd = Input::Clock::now();
+        if (governor.record(std::chrono::duration<float, std::milli>(drawStart - calcStart).count(), std::chrono::duration<float, std::milli>(drawEnd - drawStart).count()))
+            applyQuality();
+
+#if ALLOC_TRACKER
+        // steady state ticks must not touch the heap
+        const unsigned long long tickAllocations = AllocTracker::thread().allocations - allocsBefore;
+        if (checkAllocs && tickAllocations != 0) {
+            AllocTracker::zones(allocZonesAfter);
+            std::cerr << "tick " << calcTick << " allocated " << tickAllocations << " times:\n" << AllocTracker::describe(allocZones, allocZonesAfter);
+            Telemetry::close();
+            return 1;
+        }
+#endif
+
 #if DEBUG_TIMER
         drawTimer.record();
         frameTimer.record();
+
+        // feed overlay (shown from the next frame)
+        FrameStats frameStats;
+        frameStats.tick = calcTick;
+        frameStats.inputTime = inputTimer.getLast() / 1e6f;
+        frameStats.calcTime = calcTimer.getLast() / 1e6f;
+        frameStats.drawTime = drawTimer.getLast() / 1e6f;
+        frameStats.frameTime = frameTimer.getLast() / 1e6f;
+        frameStats.bullets = Bullet::bullets.size();
+        frameStats.spawned = Bullet::spawned - lastSpawned;
+        frameStats.removed = Bullet::removed - lastRemoved;
+        lastSpawned = Bullet::spawned;
+        lastRemoved = Bullet::removed;
+        frameStats.voices = Mixer::activeVoices();
+        frameStats.audioDrops = (int)(Mixer::droppedCommands() - lastAudioDrops);
+        lastAudioDrops = Mixer::droppedCommands();
+        frameStats.nodes = sceneGraph.getDrawStats().visited;
+        frameStats.culled = sceneGraph.getDrawStats().culled;
+        frameStats.drawCalls = sceneGraph.getDrawStats().drawCalls;
+        frameStats.scriptInstructions = Bullet::scriptInstructions;
+#if ALLOC_TRACKER
+        frameStats.allocations = tickAllocations;
+#endif
+        frameStats.poolBlocks = Pools::live();
+        frameStats.poolCapacity = Pools::capacity();
+        frameStats.arenaBytes = arenaUsed;
+        frameStats.jitterP50 = pacer.getJitter().percentile(0.5) / 1e6f;
+        frameStats.jitterP99 = pacer.getJitter().percentile(0.99) / 1e6f;
+        frameStats.jitterMax = pacer.getJitter().getMax() / 1e6f;
+        frameStats.quality = governor.getTier();
+        overlay->pushFrame(frameStats);
+        Telemetry::record(frameStats);
 #endif
 
         // DEBUG STEP
 #if DEBUG_TIMER
-        if (calcTick % FPS == 0)
-            printf("tick %d: %s %s %s %s\n", calcTick, inputTimer.log().c_str(), calcTimer.log().c_str(), drawTimer.log().c_str(), frameTimer.log().c_str());
+        if (calcTick % FPS == 0) {
+            printf("tick %d: %s %s %s %s %s %s (nodes drawn: %d culled: %d)\n", calcTick, inputTimer.log().c_str(), calcTimer.log().c_str(), drawTimer.log().c_str(), frameTimer.log().c_str(),
+                latencyTracker.log().c_str(), pacer.getJitter().log().c_str(), sceneGraph.getDrawStats().visited, sceneGraph.getDrawStats().culled);
+            pacer.getJitter().reset();
+        }
 #endif
 
         // DISPLAY
-        window.display();
+        if (!headless) {
+            PROFILE_ZONE("display");
+            window.display();
+        }
+        Input::Clock::time_point displayed = Input::Clock::now();
+        if (!headless) pacer.framePresented(displayed);
+#if LATE_INPUT_SAMPLING
+        workEstimate = (workEstimate * 7 + std::chrono::duration_cast<std::chrono::nanoseconds>(displayed - sampled)) / 8;
+#endif
+#if DEBUG_TIMER
+        if (!Input::tickEvents().empty())
+            latencyTracker.record(displayed - Input::tickEvents().front().time);
+#endif
         calcTick++;
+        frames++;
+    }
+
+    Mixer::close();
+    if (!recordPath.empty() && replayPath.empty() && !replay.save(recordPath))
+        std::cerr << "cannot write replay to " << recordPath << std::endl;
+    if (!replayPath.empty()) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+        printf("replayed %d ticks in %.2fs (%.0f ticks/s), ended at tick %d: bullets %d player %.2f,%.2f charge %.4f\n", frames, seconds, frames / seconds,
+            calcTick, (int)Bullet::bullets.size(), Player::pos.x, Player::pos.y, Player::charge);
     }
+    if (headless && !drawDumpPath.empty()) {
+        std::ofstream out(drawDumpPath);
+        headlessRenderer.dump(out);
+        if (!out) std::cerr << "cannot write draws to " << drawDumpPath << std::endl;
+    }
+#if DEBUG_TIMER
+    if (!headless) printf("frame %s\n", pacer.getTotalJitter().log().c_str());
+    printf("%sframe arena peak %zu of %zu bytes, %llu overflows\n", Pools::describe().c_str(), FrameArena::frame.getPeak(), FrameArena::frame.getCapacity(), FrameArena::frame.getOverflows());
+    Telemetry::close();
+    if (Telemetry::getDropped() != 0)
+        std::cerr << "telemetry dropped " << Telemetry::getDropped() << " records" << std::endl;
+#endif
+#if PROFILER
+    if (!tracePath.empty() && !Profiler::exportChromeTrace(tracePath))
+        std::cerr << "cannot write trace to " << tracePath << std::endl;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,304 @@
+#include "./mixer.h"
+#include "./audio.h"
+#include "./profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <thread>
+
+#if MIXER_SSE
+#include <emmintrin.h>
+#endif
+
+SpscQueue<Mixer::Command, Mixer::COMMAND_CAPACITY> Mixer::commands;
+std::atomic<unsigned long long> Mixer::blocks(0);
+unsigned long long Mixer::dropped = 0;
+unsigned int Mixer::started[Mixer::MAX_VOICES] = {};
+Mixer::Voice Mixer::voices[Mixer::MAX_VOICES];
+MusicTrack* Mixer::tracks[Mixer::MAX_MUSIC] = {};
+float Mixer::busVolume[Mixer::BUS_COUNT] = { 1.f, 1.f };
+float Mixer::duckAmount = 0.5f;
+float Mixer::duckAttack = 0.05f;
+float Mixer::duckRelease = 0.5f;
+float Mixer::duck = 1.f;
+bool Mixer::offline = false;
+std::vector<float> Mixer::mixBuffer = std::vector<float>();
+std::vector<float> Mixer::musicBuffer = std::vector<float>();
+std::vector<sf::Int16> Mixer::readBuffer = std::vector<sf::Int16>();
+std::unique_ptr<Mixer::Stream> Mixer::stream = nullptr;
+
+bool Mixer::Sample::loadFromFile(const std::string& path) {
+    sf::InputSoundFile file;
+    if (!file.openFromFile(path)) return false;
+    unsigned int channels = file.getChannelCount();
+    if (channels == 0 || channels > 2) return false;
+    std::vector<sf::Int16> raw(file.getSampleCount());
+    raw.resize(file.read(raw.data(), raw.size()));
+
+    // to stereo floats
+    std::size_t srcFrames = raw.size() / channels;
+    std::vector<float> stereo(srcFrames * CHANNELS);
+    for (std::size_t i = 0; i < srcFrames; ++i) {
+        stereo[i * 2] = raw[i * channels] / 32768.f;
+        stereo[i * 2 + 1] = raw[i * channels + channels - 1] / 32768.f;
+    }
+
+    // to mixer rate (linear)
+    if (file.getSampleRate() == SAMPLE_RATE || srcFrames < 2) {
+        data.swap(stereo);
+        return true;
+    }
+    double step = file.getSampleRate() / (double)SAMPLE_RATE;
+    std::size_t frames = (std::size_t)((srcFrames - 1) / step) + 1;
+    data = std::vector<float>(frames * CHANNELS);
+    for (std::size_t i = 0; i < frames; ++i) {
+        double pos = i * step;
+        std::size_t k = std::min<std::size_t>((std::size_t)pos, srcFrames - 2);
+        float t = (float)(pos - k);
+        for (unsigned int c = 0; c < CHANNELS; ++c)
+            data[i * 2 + c] = stereo[k * 2 + c] + (stereo[(k + 1) * 2 + c] - stereo[k * 2 + c]) * t;
+    }
+    return true;
+}
+
+Mixer::Stream::Stream() {
+    initialize(CHANNELS, SAMPLE_RATE);
+    buffer = std::vector<sf::Int16>(SAMPLE_RATE / 100 * CHANNELS); // 10ms chunks
+}
+
+Mixer::Stream::~Stream() {
+    stop();
+}
+
+bool Mixer::Stream::onGetData(Chunk& data) {
+    Mixer::mix(buffer.data(), buffer.size() / CHANNELS);
+    data.samples = buffer.data();
+    data.sampleCount = buffer.size();
+    return true;
+}
+
+void Mixer::open() {
+    if (stream) return;
+    stream = std::make_unique<Stream>();
+    stream->play();
+}
+
+void Mixer::close() {
+    stream = nullptr;
+}
+
+bool Mixer::push(const Command& command) {
+    // dropped rather than waited on (the game thread must never block on audio)
+    if (commands.push(command)) return true;
+    dropped++;
+    return false;
+}
+
+bool Mixer::play(int voice, const Sample& sample, Bus bus, float gain) {
+    Command command = {};
+    command.type = Command::playVoice;
+    command.voice = voice;
+    command.generation = started[voice] + 1;
+    command.sample = &sample;
+    command.bus = bus;
+    command.gain = gain;
+    if (!push(command)) return false;
+    started[voice] = command.generation;
+    return true;
+}
+
+bool Mixer::stop(int voice) {
+    Command command = {};
+    command.type = Command::stopVoice;
+    command.voice = voice;
+    return push(command);
+}
+
+bool Mixer::playMusic(MusicTrack& track) {
+    Command command = {};
+    command.type = Command::playMusic;
+    command.track = &track;
+    return push(command);
+}
+
+bool Mixer::stopMusic(MusicTrack& track) {
+    Command command = {};
+    command.type = Command::stopMusic;
+    command.track = &track;
+    return push(command);
+}
+
+bool Mixer::setBusVolume(Bus bus, float volume) {
+    Command command = {};
+    command.type = Command::busVolume;
+    command.bus = bus;
+    command.gain = volume;
+    return push(command);
+}
+
+bool Mixer::setDucking(float amount, float attack, float release) {
+    Command command = {};
+    command.type = Command::ducking;
+    command.gain = amount;
+    command.attack = attack;
+    command.release = release;
+    return push(command);
+}
+
+void Mixer::flush() {
+    // nothing mixing concurrently: apply here
+    if (!stream || offline) {
+        Command command;
+        while (commands.pop(command))
+            execute(command);
+        return;
+    }
+
+    // the block in progress may have drained the queue before our commands, the one after it cannot have
+    unsigned long long target = blocks.load(std::memory_order_acquire) + 2;
+    for (int i = 0; i < 1000 && blocks.load(std::memory_order_acquire) < target; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+void Mixer::finish(Voice& voice) {
+    voice.active = false;
+    voice.sample = nullptr;
+    voice.finished.store(voice.generation, std::memory_order_release);
+}
+
+void Mixer::execute(const Command& command) {
+    switch (command.type) {
+    case Command::playVoice: {
+        Voice& v = voices[command.voice];
+        v.sample = command.sample;
+        v.position = 0;
+        v.bus = command.bus;
+        v.gain = command.gain;
+        v.generation = command.generation;
+        v.active = true;
+        if (v.sample->frames() == 0) finish(v);
+        break;
+    }
+    case Command::stopVoice:
+        if (voices[command.voice].active) finish(voices[command.voice]);
+        break;
+    case Command::playMusic: {
+        if (std::find(tracks, tracks + MAX_MUSIC, command.track) != tracks + MAX_MUSIC) break;
+        MusicTrack** slot = std::find(tracks, tracks + MAX_MUSIC, nullptr);
+        if (slot != tracks + MAX_MUSIC) *slot = command.track; // over MAX_MUSIC is ignored
+        break;
+    }
+    case Command::stopMusic:
+        std::replace(tracks, tracks + MAX_MUSIC, command.track, (MusicTrack*)nullptr);
+        break;
+    case Command::busVolume:
+        busVolume[command.bus] = command.gain;
+        break;
+    case Command::ducking:
+        duckAmount = command.gain;
+        duckAttack = command.attack;
+        duckRelease = command.release;
+        break;
+    }
+}
+
+void Mixer::mixAdd(float* out, const float* in, std::size_t count, float gain) {
+    std::size_t i = 0;
+#if MIXER_SSE
+    __m128 g = _mm_set1_ps(gain);
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(in + i), g)));
+#endif
+    for (; i < count; ++i)
+        out[i] += in[i] * gain;
+}
+
+void Mixer::toInt16(const float* in, sf::Int16* out, std::size_t count) {
+    std::size_t i = 0;
+#if MIXER_SSE
+    __m128 lo = _mm_set1_ps(-1.f);
+    __m128 hi = _mm_set1_ps(1.f);
+    __m128 scale = _mm_set1_ps(32767.f);
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), lo), hi), scale));
+        __m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), lo), hi), scale));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(a, b));
+    }
+#endif
+    for (; i < count; ++i)
+        out[i] = (sf::Int16)std::lround(std::min(1.f, std::max(-1.f, in[i])) * 32767.f);
+}
+
+void Mixer::mix(sf::Int16* out, std::size_t frames) {
+    PROFILE_THREAD(offline ? "main" : "audio mixer");
+    PROFILE_ZONE("Mixer::mix");
+
+    std::size_t count = frames * CHANNELS;
+    if (mixBuffer.size() < count) {
+        mixBuffer.resize(count);
+        musicBuffer.resize(count);
+        readBuffer.resize(count);
+    }
+    std::fill(mixBuffer.begin(), mixBuffer.begin() + count, 0.f);
+
+    // apply game thread requests
+    Command command;
+    while (commands.pop(command))
+        execute(command);
+
+    // sound effects
+    bool sfxPlaying = false;
+    for (Voice& v : voices) {
+        if (!v.active) continue;
+        std::size_t n = std::min(frames, v.sample->frames() - v.position);
+        mixAdd(mixBuffer.data(), &v.sample->data[v.position * CHANNELS], n * CHANNELS, v.gain * busVolume[v.bus]);
+        v.position += n;
+        sfxPlaying |= v.bus == sfx;
+        if (v.position == v.sample->frames())
+            finish(v);
+    }
+
+    // ducking follows sound effects (smoothed per mixed block)
+    float duckTarget = sfxPlaying ? 1.f - duckAmount : 1.f;
+    float duckTime = duckTarget < duck ? duckAttack : duckRelease;
+    duck = duckTarget + (duck - duckTarget) * std::exp(-(float)frames / (SAMPLE_RATE * std::max(duckTime, 0.001f)));
+
+    // music (streamed, converted to stereo floats)
+    for (MusicTrack* track : tracks) {
+        if (track == nullptr) continue;
+        unsigned int channels = track->getChannelCount();
+        std::size_t read = track->read(readBuffer.data(), frames * channels, offline) / channels;
+        for (std::size_t i = 0; i < read; ++i) {
+            musicBuffer[i * 2] = readBuffer[i * channels] / 32768.f;
+            musicBuffer[i * 2 + 1] = readBuffer[i * channels + channels - 1] / 32768.f;
+        }
+        mixAdd(mixBuffer.data(), musicBuffer.data(), read * CHANNELS, busVolume[music] * duck);
+    }
+
+    toInt16(mixBuffer.data(), out, count);
+    blocks.fetch_add(1, std::memory_order_release);
+}
+
+bool Mixer::renderOffline(const std::string& path, int ticks, int ticksPerSecond, std::function<void(int)> script) {
+    sf::OutputSoundFile file;
+    if (!file.openFromFile(path, SAMPLE_RATE, CHANNELS)) return false;
+
+    offline = true;
+    std::vector<sf::Int16> out;
+    double frameCarry = 0;
+    for (int tick = 0; tick < ticks; ++tick) {
+        script(tick);
+        SoundEffect::tick();
+
+        // audio covered by this tick
+        frameCarry += SAMPLE_RATE / (double)ticksPerSecond;
+        std::size_t frames = (std::size_t)frameCarry;
+        frameCarry -= frames;
+        out.resize(frames * CHANNELS);
+        mix(out.data(), frames);
+        file.write(out.data(), out.size());
+    }
+    offline = false;
+    return true;
+}
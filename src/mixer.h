@@ -0,0 +1,169 @@
+#ifndef MIXER_H
+#define MIXER_H
+
+#include <SFML/Audio.hpp>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <functional>
+
+#include "./spscqueue.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIXER_SSE true
+#else
+#define MIXER_SSE false
+#endif
+
+class MusicTrack;
+
+// software mixer (sound effects and music are mixed by the engine and output as a single SFML stream)
+// the game thread never touches mixer state directly: requests are queued as commands and applied by the mixing thread
+class Mixer {
+public:
+    static constexpr unsigned int SAMPLE_RATE = 44100;
+    static constexpr unsigned int CHANNELS = 2;
+    static constexpr int MAX_VOICES = 64; // sound effect voices
+    static constexpr int MAX_MUSIC = 2; // music tracks playing at once
+
+    enum Bus {
+        sfx,
+        music,
+        BUS_COUNT
+    };
+
+    // decoded audio in mixer format (interleaved stereo floats at SAMPLE_RATE)
+    struct Sample {
+        std::vector<float> data;
+
+        std::size_t frames() const {
+            return data.size() / CHANNELS;
+        }
+
+        // decode, convert and resample a file (no audio device needed)
+        bool loadFromFile(const std::string& path);
+    };
+private:
+    // output stream pulling mixed audio (mixing runs on SFML's streaming thread)
+    class Stream : public sf::SoundStream {
+    private:
+        std::vector<sf::Int16> buffer;
+    protected:
+        bool onGetData(Chunk& data) override;
+        void onSeek(sf::Time timeOffset) override {}
+    public:
+        Stream();
+        ~Stream();
+    };
+
+    // request from the game thread (applied at the start of the next mixed block)
+    struct Command {
+        enum Type {
+            playVoice,
+            stopVoice,
+            playMusic,
+            stopMusic,
+            busVolume,
+            ducking
+        } type;
+        int voice;
+        unsigned int generation;
+        const Sample* sample;
+        Bus bus;
+        float gain; // voice gain or bus volume
+        MusicTrack* track;
+        float attack, release; // ducking
+    };
+
+    static constexpr std::size_t COMMAND_CAPACITY = 1024;
+
+    // mixing thread only, except finished
+    struct Voice {
+        const Sample* sample;
+        std::size_t position; // in frames
+        float gain;
+        Bus bus;
+        unsigned int generation; // play request being mixed
+        bool active;
+        std::atomic<unsigned int> finished; // last generation done playing (published to game thread)
+
+        Voice() : sample(nullptr), position(0), gain(1), bus(sfx), generation(0), active(false), finished(0) {}
+    };
+
+    static SpscQueue<Command, COMMAND_CAPACITY> commands;
+    static std::atomic<unsigned long long> blocks; // mixed blocks so far
+    static unsigned long long dropped; // commands dropped on a full queue (game thread)
+    static unsigned int started[MAX_VOICES]; // game thread's latest play request per voice
+    static Voice voices[MAX_VOICES];
+    static MusicTrack* tracks[MAX_MUSIC];
+    static float busVolume[BUS_COUNT];
+    static float duckAmount; // music volume lost while sound effects play
+    static float duckAttack; // seconds to reach full ducking
+    static float duckRelease; // seconds to recover
+    static float duck; // current music ducking gain
+    static bool offline;
+    static std::vector<float> mixBuffer;
+    static std::vector<float> musicBuffer;
+    static std::vector<sf::Int16> readBuffer;
+    static std::unique_ptr<Stream> stream;
+
+    static bool push(const Command& command);
+    static void execute(const Command& command);
+    static void finish(Voice& voice);
+    static void mixAdd(float* out, const float* in, std::size_t count, float gain);
+    static void toInt16(const float* in, sf::Int16* out, std::size_t count);
+public:
+    // start output to the audio device
+    static void open();
+
+    // stop output to the audio device
+    static void close();
+
+    // requests return false if the command queue is full (the request is dropped and counted)
+
+    // start a sound effect voice (replacing whatever it was playing)
+    static bool play(int voice, const Sample& sample, Bus bus, float gain);
+
+    static bool stop(int voice);
+
+    // true from the play request until the mixer finishes or stops it
+    static bool isPlaying(int voice) {
+        return voices[voice].finished.load(std::memory_order_acquire) != started[voice];
+    }
+
+    // sound effect voices playing (game thread)
+    static int activeVoices() {
+        int count = 0;
+        for (int v = 0; v < MAX_VOICES; ++v)
+            count += isPlaying(v);
+        return count;
+    }
+
+    // add/remove a music track from the mix
+    static bool playMusic(MusicTrack& track);
+    static bool stopMusic(MusicTrack& track);
+
+    static bool setBusVolume(Bus bus, float volume);
+
+    // lower music by amount while sound effects play (attack and release in seconds)
+    static bool setDucking(float amount, float attack, float release);
+
+    // requests dropped since start
+    static unsigned long long droppedCommands() {
+        return dropped;
+    }
+
+    // wait until every queued command has been applied and no block started before the call is still mixing
+    // (call before freeing anything the mixer may reference, never from the mixing thread)
+    static void flush();
+
+    // mix frames of interleaved stereo output
+    static void mix(sf::Int16* out, std::size_t frames);
+
+    // run script once per tick and write the mix to a wav file instead of the audio device
+    static bool renderOffline(const std::string& path, int ticks, int ticksPerSecond, std::function<void(int)> script);
+};
+
+#endif
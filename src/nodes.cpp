@@ -0,0 +1,30 @@
+# include "./nodes.h"
+
+Node::DrawStats Node::drawStats = Node::DrawStats();
+bool Node::cullEnabled = false;
+sf::FloatRect Node::cullRect = sf::FloatRect();
+
+void Node::drawChildren(Renderer& target, const sf::Transform& trans, int calcTick) {
+    for (const std::shared_ptr<Node>& node : childNodes) {
+        if (node->outOfView(trans)) {
+            drawStats.culled++;
+            continue;
+        }
+
+        // qualified calls are direct (and inlinable), only custom nodes pay for the virtual call
+        switch (node->kind) {
+        case group:
+            node->Node::draw(target, trans, calcTick);
+            break;
+        case circles:
+            static_cast<CircleNode&>(*node).CircleNode::draw(target, trans, calcTick);
+            break;
+        case sprite:
+            static_cast<ObjectSprite&>(*node).ObjectSprite::draw(target, trans, calcTick);
+            break;
+        default:
+            node->draw(target, trans, calcTick);
+            break;
+        }
+    }
+}
@@ -9,25 +9,83 @@
 
 #include <SFML/Graphics.hpp>
 
+#include "./renderer.h"
+#include "./pool.h"
+
 // node on scenegraph heirarchy
 class Node {
+public:
+    // traversal counters (reset every draw tick for profiling)
+    struct DrawStats {
+        int visited; // nodes drawn
+        int culled; // subtrees skipped for being outside the view
+        int drawCalls; // from the renderer
+        long long vertices;
+        int stateChanges;
+
+        DrawStats() : visited(0), culled(0), drawCalls(0), vertices(0), stateChanges(0) {}
+    };
+
+    static DrawStats drawStats;
+    static bool cullEnabled;
+    static sf::FloatRect cullRect; // world space area visible to the render target
+
+    typedef std::list<std::shared_ptr<Node>, PoolAllocator<std::shared_ptr<Node>>> ChildList; // list entries come from the pools
+
+    // how traversal draws a node: built in kinds are switched on and called directly, custom nodes go through
+    // the virtual draw (nodes overriding draw must be custom, which is what the default constructor makes)
+    enum Kind : unsigned char {
+        group, // children only
+        circles, // CircleNode
+        sprite, // ObjectSprite
+        custom
+    };
 private:
     Node* parent; // parent 
+    Kind kind;
+    bool hasBounds;
+    sf::FloatRect bounds; // local bounds covering self and children
 
     // sets parent
     void setParent(Node* parent) {
         this->parent = parent;
     }
 protected:
-    std::list<std::shared_ptr<Node>> childNodes;
+    ChildList childNodes;
+
+    // draw children under trans (the node's own transform already applied)
+    void drawChildren(Renderer& target, const sf::Transform& trans, int calcTick);
 public:
     sf::Transformable tf; // local transformable
 
     // constructor
-    Node() : parent(nullptr) {}
+    Node(Kind kind) : parent(nullptr), kind(kind), hasBounds(false) {}
+
+    Node() : Node(custom) {}
+
+    Kind getKind() const {
+        return kind;
+    }
+
+    // set local bounds (subtree skipped when bounds are out of view)
+    void setBounds(sf::FloatRect bounds) {
+        this->bounds = bounds;
+        hasBounds = true;
+    }
+
+    // remove bounds (always drawn)
+    void clearBounds() {
+        hasBounds = false;
+    }
+
+    // returns true iff node has bounds and they fall outside the cull area
+    bool outOfView(const sf::Transform& parentTrans) {
+        if (!cullEnabled || !hasBounds) return false;
+        return !(parentTrans * tf.getTransform()).transformRect(bounds).intersects(cullRect);
+    }
 
     // get children
-    const std::list<std::shared_ptr<Node>>& getChildren() {
+    const ChildList& getChildren() {
         return childNodes;
     }
 
@@ -39,6 +97,28 @@ public:
         return true;
     }
 
+    // add child without the duplicate check (for owners that know the child is new)
+    void appendChild(std::shared_ptr<Node> child) {
+        child->setParent(this);
+        childNodes.push_back(std::move(child));
+    }
+
+    // replace children with child(0) ... child(count - 1), reusing list entries (no duplicate check)
+    template <typename ChildAt>
+    void assignChildren(std::size_t count, ChildAt child) {
+        std::size_t i = 0;
+        auto it = childNodes.begin();
+        for (; i < count && it != childNodes.end(); ++i, ++it) {
+            *it = child(i);
+            (*it)->setParent(this);
+        }
+        childNodes.erase(it, childNodes.end());
+        for (; i < count; ++i) {
+            childNodes.push_back(child(i));
+            childNodes.back()->setParent(this);
+        }
+    }
+
     // remove child (return if succeeds)
     bool removeChild(std::shared_ptr<Node> child) {
         int s = childNodes.size();
@@ -46,44 +126,86 @@ public:
         return s < childNodes.size();
     }
 
+    // remove every child pred is true for in one pass, visiting children in order (returns how many)
+    template <typename Pred>
+    std::size_t removeChildrenIf(Pred pred) {
+        std::size_t count = 0;
+        for (auto it = childNodes.begin(); it != childNodes.end();) {
+            if (pred(*it)) {
+                (*it)->setParent(nullptr);
+                it = childNodes.erase(it);
+                count++;
+            } else {
+                ++it;
+            }
+        }
+        return count;
+    }
+
     // get absoluate transform (recursive call up the scene graph)
     sf::Transform getAbsTransform() {
         return parent->getAbsTransform() * tf.getTransform();
     }
 
     // draw self and children
-    virtual void draw(sf::RenderTarget& target, const sf::Transform &parentTrans, int calcTick) {
-        sf::Transform trans = parentTrans * tf.getTransform();
-        for (const std::shared_ptr<Node>& node : childNodes) {
-            node->draw(target, trans, calcTick);
-        }
+    virtual void draw(Renderer& target, const sf::Transform &parentTrans, int calcTick) {
+        drawStats.visited++;
+        drawChildren(target, parentTrans * tf.getTransform(), calcTick);
     }
 
     static std::shared_ptr<Node> create() {
-        return std::make_shared<Node>();
+        return makePooled<Node>(group);
     }
 };
 
-// node that can be drawn
+// node that can be drawn (the draw function is the slow path, for one off nodes)
 class DrawableNode : public Node {
 private:
-    std::function<void(sf::RenderTarget&, const sf::Transform&, int)> drawFunction;
+    std::function<void(Renderer&, const sf::Transform&, int)> drawFunction;
+protected:
+    DrawableNode(Kind kind) : Node(kind) {}
 public:
-    DrawableNode(std::function<void(sf::RenderTarget&, sf::Transform, int)> drawFunction) : drawFunction(drawFunction) {}
+    DrawableNode(std::function<void(Renderer&, const sf::Transform&, int)> drawFunction) : drawFunction(drawFunction) {}
 
-    DrawableNode() : drawFunction([](sf::RenderTarget&, sf::Transform, int) {}) {}
+    DrawableNode() : drawFunction([](Renderer&, const sf::Transform&, int) {}) {}
 
-    virtual void draw(sf::RenderTarget& target, const sf::Transform& parentTrans, int calcTick) override {
+    virtual void draw(Renderer& target, const sf::Transform& parentTrans, int calcTick) override {
         drawFunction(target, parentTrans * tf.getTransform(), calcTick);
         Node::draw(target, parentTrans, calcTick);
     }
 
     static std::shared_ptr<DrawableNode> create() {
-        return std::make_shared<DrawableNode>();
+        return makePooled<DrawableNode>();
+    }
+
+    static std::shared_ptr<DrawableNode> create(std::function<void(Renderer&, const sf::Transform&, int)> drawFunction) {
+        return makePooled<DrawableNode>(drawFunction);
+    }
+};
+
+// node drawing circles kept by their owner (set again whenever the owner's storage moves)
+class CircleNode : public Node {
+private:
+    const sf::CircleShape* shapes;
+    std::size_t count;
+public:
+    CircleNode() : Node(circles), shapes(nullptr), count(0) {}
+
+    void setCircles(const sf::CircleShape* shapes, std::size_t count) {
+        this->shapes = shapes;
+        this->count = count;
+    }
+
+    void draw(Renderer& target, const sf::Transform& parentTrans, int calcTick) override {
+        sf::Transform trans = parentTrans * tf.getTransform();
+        for (std::size_t i = 0; i < count; ++i)
+            target.draw(shapes[i], trans);
+        drawStats.visited++;
+        drawChildren(target, trans, calcTick);
     }
 
-    static std::shared_ptr<DrawableNode> create(std::function<void(sf::RenderTarget&, sf::Transform, int)> drawFunction) {
-        return std::make_shared<DrawableNode>(drawFunction);
+    static std::shared_ptr<CircleNode> create() {
+        return makePooled<CircleNode>();
     }
 };
 
@@ -97,13 +219,18 @@ protected:
         }
     }
 
-    ObjectSprite() : DrawableNode([this](sf::RenderTarget& target, sf::Transform trans, int calcTick) {
-        target.draw(sprite, trans);
-        }) {}
+    ObjectSprite(Kind kind = Node::sprite) : DrawableNode(kind) {}
 public:
     sf::Sprite& getSprite() {
         return sprite;
     }
+
+    virtual void draw(Renderer& target, const sf::Transform& parentTrans, int calcTick) override {
+        sf::Transform trans = parentTrans * tf.getTransform();
+        target.draw(sprite, trans);
+        drawStats.visited++;
+        drawChildren(target, trans, calcTick);
+    }
 };
 
 // node with a single texture
@@ -133,16 +260,12 @@ protected:
 public:
     void setIndex(int index) {
         this->index = index;
+        updateSprite();
     }
     int getIndex() {
         return index;
     }
     virtual int size() { return 0; } // returns size of indexed collection of textures
-
-    virtual void draw(sf::RenderTarget& target, const sf::Transform& parentTrans, int calcTick) override {
-        updateSprite();
-        ObjectSprite::draw(target, parentTrans, calcTick);
-    }
 };
 
 // indexed sprite using an array of textures
@@ -187,6 +310,7 @@ public:
         loadTexture(texture, spriteSheetPath);
         activeRect.width = imgWidth;
         activeRect.height = imgHeight;
+        updateSprite();
     }
 
     void setIndex(int row, int col) {
@@ -211,10 +335,10 @@ private:
     const int frameDelay;
     const LoopType loopType;
 public:
-    AnimatedSprite(IndexedSprite sprite, int frameDelay, LoopType loopType) : sprite(sprite), frameDelay(frameDelay), loopType(loopType) {}
+    AnimatedSprite(IndexedSprite sprite, int frameDelay, LoopType loopType) : ObjectSprite(custom), sprite(sprite), frameDelay(frameDelay), loopType(loopType) {}
     AnimatedSprite(IndexedSprite sprite, int frameDelay) : AnimatedSprite(sprite, frameDelay, LoopType::forward) {}
 
-    virtual void draw(sf::RenderTarget& target, const sf::Transform& parentTrans, int calcTick) override {
+    virtual void draw(Renderer& target, const sf::Transform& parentTrans, int calcTick) override {
         switch (loopType) {
         case forward:
             sprite.setIndex((calcTick / frameDelay) % sprite.size());
@@ -0,0 +1,112 @@
+#include "./overlay.h"
+#include "./profiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+const std::array<unsigned short, 128> PerfOverlay::glyphs = [] {
+    std::array<unsigned short, 128> g = {};
+    const char* chars = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.:/-%";
+    const unsigned short bitmaps[] = {
+        0b111'101'101'101'111, 0b010'110'010'010'111, 0b111'001'111'100'111, 0b111'001'111'001'111, 0b101'101'111'001'001,
+        0b111'100'111'001'111, 0b111'100'111'101'111, 0b111'001'001'001'001, 0b111'101'111'101'111, 0b111'101'111'001'111,
+        0b010'101'111'101'101, 0b110'101'110'101'110, 0b011'100'100'100'011, 0b110'101'101'101'110, 0b111'100'110'100'111, // A-E
+        0b111'100'110'100'100, 0b011'100'101'101'011, 0b101'101'111'101'101, 0b111'010'010'010'111, 0b001'001'001'101'010, // F-J
+        0b101'101'110'101'101, 0b100'100'100'100'111, 0b101'111'111'101'101, 0b110'101'101'101'101, 0b010'101'101'101'010, // K-O
+        0b110'101'110'100'100, 0b010'101'101'110'011, 0b110'101'110'101'101, 0b011'100'010'001'110, 0b111'010'010'010'010, // P-T
+        0b101'101'101'101'111, 0b101'101'101'101'010, 0b101'101'111'111'101, 0b101'101'010'101'101, 0b101'101'010'010'010, // U-Y
+        0b111'001'010'100'111, // Z
+        0b000'000'000'000'010, 0b000'010'000'010'000, 0b001'001'010'100'100, 0b000'000'111'000'000, 0b101'001'010'100'101
+    };
+    for (int i = 0; chars[i]; ++i)
+        g[(int)chars[i]] = bitmaps[i];
+    return g;
+}();
+
+static const float PIXEL = 2.f; // font and graph pixel size
+static const float GRAPH_HEIGHT = 64.f;
+static const float ADVANCE = 4 * PIXEL; // per character
+static const float LINE_HEIGHT = 7 * PIXEL;
+static const int LINES = 8;
+static const sf::Color INPUT_COLOR(80, 220, 80);
+static const sf::Color CALC_COLOR(240, 200, 60);
+static const sf::Color DRAW_COLOR(80, 140, 255);
+
+void PerfOverlay::quad(float x, float y, float w, float h, sf::Color color) {
+    sf::Vertex a({ x, y }, color), b({ x + w, y }, color), c({ x + w, y + h }, color), d({ x, y + h }, color);
+    vertices.append(a);
+    vertices.append(b);
+    vertices.append(c);
+    vertices.append(a);
+    vertices.append(c);
+    vertices.append(d);
+}
+
+void PerfOverlay::print(float x, float y, const char* s, sf::Color color) {
+    for (; *s; ++s, x += ADVANCE) {
+        unsigned char ch = (unsigned char)std::toupper((unsigned char)*s);
+        unsigned short bits = ch < 128 ? glyphs[ch] : 0;
+        for (int row = 0; row < 5; ++row)
+            for (int col = 0; col < 3; ++col)
+                if (bits & (1 << (14 - row * 3 - col)))
+                    quad(x + col * PIXEL, y + row * PIXEL, PIXEL, PIXEL, color);
+    }
+}
+
+void PerfOverlay::draw(Renderer& target, const sf::Transform& parentTrans, int calcTick) {
+    if (!visible) return;
+    PROFILE_ZONE("PerfOverlay::draw");
+
+    // capacity is kept between frames
+    vertices.clear();
+    const float width = HISTORY * PIXEL;
+    quad(0, 0, width + 4 * PIXEL, GRAPH_HEIGHT + LINES * LINE_HEIGHT + 6 * PIXEL, sf::Color(0, 0, 0, 160));
+
+    // stacked frame times (oldest on the left, budget at half height)
+    float scale = GRAPH_HEIGHT * 0.5f / budget;
+    float x0 = 2 * PIXEL, y0 = 2 * PIXEL + GRAPH_HEIGHT;
+    float maxFrame = 0;
+    for (int i = 0; i < HISTORY; ++i) {
+        const FrameStats& f = history[(newest + 1 + i) % HISTORY];
+        float x = x0 + i * PIXEL;
+        float input = std::min(f.inputTime * scale, GRAPH_HEIGHT);
+        float calc = std::min(f.calcTime * scale, GRAPH_HEIGHT - input);
+        float draw = std::min(f.drawTime * scale, GRAPH_HEIGHT - input - calc);
+        if (input > 0) quad(x, y0 - input, PIXEL, input, INPUT_COLOR);
+        if (calc > 0) quad(x, y0 - input - calc, PIXEL, calc, CALC_COLOR);
+        if (draw > 0) quad(x, y0 - input - calc - draw, PIXEL, draw, DRAW_COLOR);
+        maxFrame = std::max(maxFrame, f.inputTime + f.calcTime + f.drawTime);
+    }
+    quad(x0, y0 - budget * scale, width, 1, sf::Color::Red);
+
+    // counters of the last frame
+    const FrameStats& f = history[newest];
+    float y = y0 + 2 * PIXEL;
+    std::snprintf(text, sizeof(text), "frame %.2f ms max %.2f", f.inputTime + f.calcTime + f.drawTime, maxFrame);
+    print(x0, y, text, sf::Color::White);
+    std::snprintf(text, sizeof(text), "in %.2f", f.inputTime);
+    print(x0, y += LINE_HEIGHT, text, INPUT_COLOR);
+    std::snprintf(text, sizeof(text), "calc %.2f", f.calcTime);
+    print(x0 + 9 * ADVANCE, y, text, CALC_COLOR);
+    std::snprintf(text, sizeof(text), "draw %.2f", f.drawTime);
+    print(x0 + 20 * ADVANCE, y, text, DRAW_COLOR);
+    std::snprintf(text, sizeof(text), "bullets %d", f.bullets);
+    print(x0, y += LINE_HEIGHT, text, sf::Color::White);
+    std::snprintf(text, sizeof(text), "nodes %d culled %d", f.nodes, f.culled);
+    print(x0, y += LINE_HEIGHT, text, sf::Color::White);
+    std::snprintf(text, sizeof(text), "draws %d quality %d", f.drawCalls, f.quality);
+    print(x0, y += LINE_HEIGHT, text, sf::Color::White);
+    std::snprintf(text, sizeof(text), "script %lld", f.scriptInstructions);
+    print(x0, y += LINE_HEIGHT, text, sf::Color::White);
+    if (f.allocations < 0) std::snprintf(text, sizeof(text), "alloc - pool %d/%d", f.poolBlocks, f.poolCapacity);
+    else std::snprintf(text, sizeof(text), "alloc %lld pool %d/%d", f.allocations, f.poolBlocks, f.poolCapacity);
+    print(x0, y += LINE_HEIGHT, text, sf::Color::White);
+    std::snprintf(text, sizeof(text), "jitter %.2f/%.2f/%.2f", f.jitterP50, f.jitterP99, f.jitterMax);
+    print(x0, y += LINE_HEIGHT, text, sf::Color::White);
+
+    sf::RenderStates states;
+    states.transform = parentTrans * tf.getTransform();
+    target.draw(vertices, states);
+    Node::draw(target, parentTrans, calcTick);
+}
@@ -0,0 +1,50 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include "./nodes.h"
+#include "./framestats.h"
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <array>
+#include <memory>
+
+// performance overlay (rolling stacked frame time graph and counters of the last frame)
+// everything is built into one vertex array with a built in 3x5 pixel font, so it costs a single draw call
+class PerfOverlay : public Node {
+public:
+    static constexpr int HISTORY = 120; // frames in graph
+private:
+    static const std::array<unsigned short, 128> glyphs; // 3x5 bitmaps by ascii (15 bits, top left is the highest bit)
+
+    std::vector<FrameStats> history; // ring
+    int newest;
+    float budget; // frame time budget in ms (marked on graph)
+    sf::VertexArray vertices;
+    char text[64];
+
+    void quad(float x, float y, float w, float h, sf::Color color);
+    void print(float x, float y, const char* s, sf::Color color);
+public:
+    bool visible;
+
+    PerfOverlay(float budget) : history(HISTORY), newest(0), budget(budget), vertices(sf::Triangles), visible(true) {}
+
+    // record a finished frame
+    void pushFrame(const FrameStats& stats) {
+        newest = (newest + 1) % HISTORY;
+        history[newest] = stats;
+    }
+
+    const FrameStats& lastFrame() const {
+        return history[newest];
+    }
+
+    virtual void draw(Renderer& target, const sf::Transform& parentTrans, int calcTick) override;
+
+    static std::shared_ptr<PerfOverlay> create(float budget) {
+        return std::make_shared<PerfOverlay>(budget);
+    }
+};
+
+#endif
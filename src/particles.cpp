@@ -0,0 +1,139 @@
+# include "./particles.h"
+# include "./bullets.h"
+# include "./profiler.h"
+
+# include <cmath>
+
+ParticleSystem::Layer::Layer(sf::BlendMode blendMode, int capacity)
+    : blendMode(blendMode), x(capacity), y(capacity), vx(capacity), vy(capacity), age(capacity), ageStep(capacity),
+    style(capacity), tint(capacity), count(0), vertices(sf::Triangles, capacity * 6) {}
+
+void ParticleSystem::Layer::remove(int i) {
+    count--;
+    x[i] = x[count];
+    y[i] = y[count];
+    vx[i] = vx[count];
+    vy[i] = vy[count];
+    age[i] = age[count];
+    ageStep[i] = ageStep[count];
+    style[i] = style[count];
+    tint[i] = tint[count];
+}
+
+ParticleSystem::ParticleSystem(int capacity) : capacity(capacity), alphaLayer(sf::BlendAlpha, capacity), addLayer(sf::BlendAdd, capacity), rng(Rng::game.next()), bulletDeathListener(-1), density(1), visible(true) {}
+
+ParticleSystem::~ParticleSystem() {
+    Bullet::removeDeathListener(bulletDeathListener);
+}
+
+void ParticleSystem::emit(int style, float x, float y, float vx, float vy, sf::Color tint) {
+    Layer& layer = layerOf(style);
+    if (layer.count == capacity) return;
+    int i = layer.count++;
+    layer.x[i] = x;
+    layer.y[i] = y;
+    layer.vx[i] = vx;
+    layer.vy[i] = vy;
+    layer.age[i] = 0;
+    layer.ageStep[i] = 1.f / styles[style].lifetime;
+    layer.style[i] = style;
+    layer.tint[i] = tint;
+}
+
+void ParticleSystem::burst(int style, float x, float y, int count, float speedMin, float speedMax, sf::Color tint) {
+    if (density != 1) count = (int)std::ceil(count * density);
+    for (int i = 0; i < count; ++i) {
+        float dir = random(0, M_PI * 2);
+        float speed = random(speedMin, speedMax);
+        emit(style, x, y, std::cos(dir) * speed, std::sin(dir) * speed, tint);
+    }
+}
+
+void ParticleSystem::emitOnBulletDeath(int style, int count, float speedMin, float speedMax) {
+    Bullet::removeDeathListener(bulletDeathListener);
+    bulletDeathListener = Bullet::addDeathListener([this, style, count, speedMin, speedMax](Bullet& b) {
+        burst(style, b.x, b.y, count, speedMin, speedMax, b.color);
+        });
+}
+
+void ParticleSystem::tick() {
+    PROFILE_ZONE("ParticleSystem::tick");
+
+    // continuous emitters
+    for (const std::shared_ptr<Emitter>& e : emitters) {
+        if (!e->active) continue;
+        e->accumulator += e->rate * density;
+        for (; e->accumulator >= 1.f; e->accumulator -= 1.f) {
+            float dir = random(e->dirMin, e->dirMax);
+            float speed = random(e->speedMin, e->speedMax);
+            emit(e->style,
+                random(e->area.left, e->area.left + e->area.width),
+                random(e->area.top, e->area.top + e->area.height),
+                std::cos(dir) * speed, std::sin(dir) * speed, e->tint);
+        }
+    }
+
+    update(alphaLayer);
+    update(addLayer);
+}
+
+void ParticleSystem::update(Layer& layer) {
+    // age and remove expired
+    for (int i = 0; i < layer.count; ++i) {
+        layer.age[i] += layer.ageStep[i];
+        if (layer.age[i] >= 1.f)
+            layer.remove(i--);
+    }
+
+    // forces
+    for (int i = 0; i < layer.count; ++i) {
+        const ParticleStyle& s = styles[layer.style[i]];
+        float keep = 1.f - s.drag;
+        layer.vx[i] = layer.vx[i] * keep + s.gravity.x;
+        layer.vy[i] = layer.vy[i] * keep + s.gravity.y;
+    }
+
+    // move
+    float* x = layer.x.data();
+    float* y = layer.y.data();
+    const float* vx = layer.vx.data();
+    const float* vy = layer.vy.data();
+    for (int i = 0; i < layer.count; ++i) {
+        x[i] += vx[i];
+        y[i] += vy[i];
+    }
+}
+
+void ParticleSystem::drawLayer(Layer& layer, Renderer& target, const sf::Transform& trans) {
+    if (layer.count == 0) return;
+
+    // two triangles per particle
+    sf::Vertex* v = &layer.vertices[0];
+    for (int i = 0; i < layer.count; ++i, v += 6) {
+        const ParticleStyle& s = styles[layer.style[i]];
+        float h = s.size.sample(layer.age[i]);
+        sf::Color c = s.color.sample(layer.age[i]) * layer.tint[i];
+        float l = layer.x[i] - h, r = layer.x[i] + h;
+        float t = layer.y[i] - h, b = layer.y[i] + h;
+        v[0].position = { l, t };
+        v[1].position = { r, t };
+        v[2].position = { r, b };
+        v[3].position = { l, t };
+        v[4].position = { r, b };
+        v[5].position = { l, b };
+        for (int k = 0; k < 6; ++k)
+            v[k].color = c;
+    }
+
+    sf::RenderStates states(layer.blendMode);
+    states.transform = trans;
+    target.draw(&layer.vertices[0], layer.count * 6, sf::Triangles, states);
+}
+
+void ParticleSystem::draw(Renderer& target, const sf::Transform& parentTrans, int calcTick) {
+    if (!visible) return;
+    sf::Transform trans = parentTrans * tf.getTransform();
+    drawLayer(alphaLayer, target, trans);
+    drawLayer(addLayer, target, trans);
+    Node::draw(target, parentTrans, calcTick);
+}
@@ -0,0 +1,182 @@
+# ifndef PARTICLES_H
+# define PARTICLES_H
+
+# include "./scenegraph.h"
+# include "./rng.h"
+
+# include <SFML/Graphics.hpp>
+# include <vector>
+# include <memory>
+# include <utility>
+
+// value keyed over a particle's normalized lifetime [0, 1] (baked into a lookup table)
+template <typename T>
+class Curve {
+public:
+    static const int RESOLUTION = 64;
+private:
+    T table[RESOLUTION];
+
+    static float lerp(float a, float b, float t) {
+        return a + (b - a) * t;
+    }
+
+    static sf::Color lerp(sf::Color a, sf::Color b, float t) {
+        return sf::Color(
+            (sf::Uint8)lerp(a.r, b.r, t),
+            (sf::Uint8)lerp(a.g, b.g, t),
+            (sf::Uint8)lerp(a.b, b.b, t),
+            (sf::Uint8)lerp(a.a, b.a, t));
+    }
+public:
+    // constant curve
+    Curve(T value) {
+        for (int i = 0; i < RESOLUTION; ++i)
+            table[i] = value;
+    }
+
+    // piecewise linear curve through keys (pairs of time, value sorted by time)
+    Curve(std::vector<std::pair<float, T>> keys) {
+        if (keys.size() == 0) throw("curve needs at least one key");
+        int k = 0;
+        for (int i = 0; i < RESOLUTION; ++i) {
+            float t = i / (float)(RESOLUTION - 1);
+            while (k + 1 < keys.size() && keys[k + 1].first <= t) k++;
+            if (k + 1 == keys.size() || t <= keys[k].first) {
+                table[i] = keys[k].second;
+                continue;
+            }
+            float span = keys[k + 1].first - keys[k].first;
+            table[i] = lerp(keys[k].second, keys[k + 1].second, (t - keys[k].first) / span);
+        }
+    }
+
+    // sample curve at normalized age t in [0, 1]
+    const T& sample(float t) const {
+        return table[(int)(t * (RESOLUTION - 1) + 0.5f)];
+    }
+};
+
+// shared behaviour of a kind of particle
+struct ParticleStyle {
+    Curve<sf::Color> color; // multiplied with per particle tint
+    Curve<float> size; // half width of particle quad
+    int lifetime; // in ticks
+    sf::Vector2f gravity; // added to velocity every tick
+    float drag; // fraction of velocity lost every tick
+    bool additive; // drawn with additive blending if true, alpha blending otherwise
+
+    ParticleStyle(Curve<sf::Color> color, Curve<float> size, int lifetime, sf::Vector2f gravity = { 0, 0 }, float drag = 0, bool additive = false)
+        : color(color), size(size), lifetime(lifetime), gravity(gravity), drag(drag), additive(additive) {}
+};
+
+// node simulating and drawing many particles (one vertex array per blend mode)
+class ParticleSystem : public Node {
+public:
+    // spawns particles at a constant rate inside of an area
+    struct Emitter {
+        int style;
+        sf::FloatRect area; // spawn area (local coordinates)
+        float rate; // particles per tick
+        float dirMin, dirMax; // direction range (radians)
+        float speedMin, speedMax;
+        sf::Color tint;
+        bool active;
+        float accumulator; // fractional particles carried between ticks
+
+        Emitter(int style, sf::FloatRect area, float rate, float dirMin, float dirMax, float speedMin, float speedMax, sf::Color tint)
+            : style(style), area(area), rate(rate), dirMin(dirMin), dirMax(dirMax), speedMin(speedMin), speedMax(speedMax), tint(tint), active(true), accumulator(0) {}
+    };
+private:
+    // particle storage for one blend mode (structure of arrays, swap removal)
+    struct Layer {
+        sf::BlendMode blendMode;
+        std::vector<float> x, y, vx, vy;
+        std::vector<float> age, ageStep; // normalized age and its increment per tick
+        std::vector<unsigned short> style;
+        std::vector<sf::Color> tint;
+        int count;
+        sf::VertexArray vertices;
+
+        Layer(sf::BlendMode blendMode, int capacity);
+        void remove(int i);
+    };
+
+    const int capacity; // max particles per layer
+    std::vector<ParticleStyle> styles;
+    std::vector<std::shared_ptr<Emitter>> emitters;
+    Layer alphaLayer;
+    Layer addLayer;
+    Rng rng; // seeded from the game stream when created
+    int bulletDeathListener; // id of the emitOnBulletDeath listener (-1 if none)
+
+    float random(float min, float max) {
+        return rng.uniform(min, max);
+    }
+
+    Layer& layerOf(int style) {
+        return styles[style].additive ? addLayer : alphaLayer;
+    }
+
+    void update(Layer& layer);
+    void drawLayer(Layer& layer, Renderer& target, const sf::Transform& trans);
+public:
+    float density; // fraction of burst and emitter particles actually spawned (quality setting, 1 by default)
+    bool visible; // drawn if true (hidden systems still tick)
+
+    ParticleSystem(int capacity);
+    ~ParticleSystem();
+
+    // register a style (returns id used when emitting)
+    int addStyle(ParticleStyle style) {
+        styles.push_back(style);
+        return styles.size() - 1;
+    }
+
+    // spawn a single particle (dropped if layer full)
+    void emit(int style, float x, float y, float vx, float vy, sf::Color tint = sf::Color::White);
+
+    // spawn count particles from a point in random directions (scaled by density, rounded up)
+    void burst(int style, float x, float y, int count, float speedMin, float speedMax, sf::Color tint = sf::Color::White);
+
+    // spawn a burst tinted with the bullet's color whenever a bullet dies (replaces this system's previous one, removed
+    // when the system is destroyed)
+    void emitOnBulletDeath(int style, int count, float speedMin, float speedMax);
+
+    // add continuous emitter (deactivate or remove to stop)
+    std::shared_ptr<Emitter> addEmitter(Emitter emitter) {
+        emitters.push_back(std::make_shared<Emitter>(emitter));
+        return emitters.back();
+    }
+
+    void removeEmitter(std::shared_ptr<Emitter> emitter) {
+        emitters.erase(std::remove(emitters.begin(), emitters.end(), emitter), emitters.end());
+    }
+
+    // run emitters then advance particles by a tick
+    void tick();
+
+    // run ticks ahead of time so continuous effects start filled
+    void prewarm(int ticks) {
+        for (int i = 0; i < ticks; ++i)
+            tick();
+    }
+
+    // remove all particles
+    void clear() {
+        alphaLayer.count = 0;
+        addLayer.count = 0;
+    }
+
+    int size() {
+        return alphaLayer.count + addLayer.count;
+    }
+
+    virtual void draw(Renderer& target, const sf::Transform& parentTrans, int calcTick) override;
+
+    static std::shared_ptr<ParticleSystem> create(int capacity) {
+        return std::make_shared<ParticleSystem>(capacity);
+    }
+};
+
+# endif
@@ -0,0 +1,90 @@
+#include "./pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+Pools::SizeClass Pools::classes[MAX_BLOCK / GRANULARITY] = {};
+std::size_t Pools::chunkBytes = 0;
+
+FrameArena FrameArena::frame(256 * 1024);
+
+// chunks are never returned (the block count is the pool's high water mark)
+void Pools::grow(SizeClass& sizeClass, std::size_t blockSize) {
+    std::size_t blocks = std::max<std::size_t>(CHUNK / blockSize, 16);
+    unsigned char* chunk = static_cast<unsigned char*>(::operator new(blocks * blockSize));
+    chunkBytes += blocks * blockSize;
+    for (std::size_t i = blocks; i-- > 0;) {
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + i * blockSize);
+        block->next = sizeClass.free;
+        sizeClass.free = block;
+    }
+    sizeClass.capacity += blocks;
+}
+
+void* Pools::allocate(std::size_t bytes) {
+    std::size_t index = bytes == 0 ? 0 : (bytes - 1) / GRANULARITY;
+    SizeClass& sizeClass = classes[index];
+    if (sizeClass.free == nullptr) grow(sizeClass, (index + 1) * GRANULARITY);
+    FreeBlock* block = sizeClass.free;
+    sizeClass.free = block->next;
+    sizeClass.live++;
+    if (sizeClass.live > sizeClass.peak) sizeClass.peak = sizeClass.live;
+    return block;
+}
+
+void Pools::deallocate(void* p, std::size_t bytes) {
+    if (p == nullptr) return;
+    SizeClass& sizeClass = classes[bytes == 0 ? 0 : (bytes - 1) / GRANULARITY];
+    FreeBlock* block = static_cast<FreeBlock*>(p);
+    block->next = sizeClass.free;
+    sizeClass.free = block;
+    sizeClass.live--;
+}
+
+void Pools::occupancy(std::vector<Occupancy>& out) {
+    out.clear();
+    for (std::size_t i = 0; i < MAX_BLOCK / GRANULARITY; ++i)
+        if (classes[i].capacity != 0)
+            out.push_back({ (i + 1) * GRANULARITY, classes[i].live, classes[i].peak, classes[i].capacity });
+}
+
+std::size_t Pools::live() {
+    std::size_t total = 0;
+    for (const SizeClass& sizeClass : classes)
+        total += sizeClass.live;
+    return total;
+}
+
+std::size_t Pools::capacity() {
+    std::size_t total = 0;
+    for (const SizeClass& sizeClass : classes)
+        total += sizeClass.capacity;
+    return total;
+}
+
+std::string Pools::describe() {
+    std::vector<Occupancy> used;
+    occupancy(used);
+    std::string s;
+    char line[96];
+    for (const Occupancy& o : used) {
+        std::snprintf(line, sizeof(line), "pool %4zuB: %zu live, peak %zu of %zu blocks\n", o.blockSize, o.live, o.peak, o.capacity);
+        s += line;
+    }
+    std::snprintf(line, sizeof(line), "pools reserved %zu KB\n", chunkBytes / 1024);
+    s += line;
+    return s;
+}
+
+void* FrameArena::do_allocate(std::size_t bytes, std::size_t align) {
+    std::uintptr_t base = reinterpret_cast<std::uintptr_t>(buffer.get());
+    std::size_t start = ((base + used + align - 1) & ~(std::uintptr_t)(align - 1)) - base;
+    if (start + bytes > capacity) {
+        overflows++;
+        return overflow.allocate(bytes, align);
+    }
+    used = start + bytes;
+    if (used > peak) peak = used;
+    return buffer.get() + start;
+}
@@ -0,0 +1,163 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+
+// fixed size block pools for engine objects (nodes, bullets, scripts and the containers holding them)
+// requests are rounded up to a size class and served from its free list, which is carved out of chunks that are
+// kept for the whole run, so once the pools have grown to the working set creating and destroying objects never
+// touches the heap (and can't fragment it)
+// not thread safe: engine objects are only created and destroyed on the game thread
+class Pools {
+public:
+    static constexpr std::size_t GRANULARITY = 16; // size class step
+    static constexpr std::size_t MAX_BLOCK = 1024; // larger requests go to the heap
+    static constexpr std::size_t CHUNK = 64 * 1024; // bytes carved per growth (at least 16 blocks)
+
+    struct Occupancy {
+        std::size_t blockSize;
+        std::size_t live; // blocks handed out
+        std::size_t peak;
+        std::size_t capacity; // blocks carved so far
+    };
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct SizeClass {
+        FreeBlock* free;
+        std::size_t live;
+        std::size_t peak;
+        std::size_t capacity;
+    };
+
+    static SizeClass classes[MAX_BLOCK / GRANULARITY]; // constant initialized, so usable from static initializers
+    static std::size_t chunkBytes;
+
+    static void grow(SizeClass& sizeClass, std::size_t blockSize);
+public:
+    // whether a request is served by the pools
+    static constexpr bool pooled(std::size_t bytes, std::size_t align) {
+        return bytes <= MAX_BLOCK && align <= alignof(std::max_align_t);
+    }
+
+    static void* allocate(std::size_t bytes);
+    static void deallocate(void* p, std::size_t bytes);
+
+    // size classes that were used (reuses out's capacity)
+    static void occupancy(std::vector<Occupancy>& out);
+
+    // blocks handed out over all size classes
+    static std::size_t live();
+
+    // blocks carved over all size classes
+    static std::size_t capacity();
+
+    // bytes taken from the heap for chunks
+    static std::size_t reserved() {
+        return chunkBytes;
+    }
+
+    // one line per used size class
+    static std::string describe();
+};
+
+// std allocator over the pools (stateless, rebinds to any type, so containers and allocate_shared
+// control blocks get their own size class)
+template <typename T>
+class PoolAllocator {
+public:
+    typedef T value_type;
+
+    PoolAllocator() noexcept {}
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        if (Pools::pooled(n * sizeof(T), alignof(T))) return static_cast<T*>(Pools::allocate(n * sizeof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        if (Pools::pooled(n * sizeof(T), alignof(T))) Pools::deallocate(p, n * sizeof(T));
+        else ::operator delete(p);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+    return false;
+}
+
+// make_shared with the object and its control block in one pool block
+template <typename T, typename... Args>
+std::shared_ptr<T> makePooled(Args&&... args) {
+    return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+// per tick bump allocator: an allocation is a pointer bump in a preallocated buffer, deallocation does nothing and
+// everything is released at once by reset() at the end of the tick, so it only holds data that doesn't outlive the tick
+// requests past the buffer fall back to the heap until the next reset (counted as overflows, raise the capacity if they happen)
+class FrameArena : public std::pmr::memory_resource {
+private:
+    std::unique_ptr<unsigned char[]> buffer;
+    std::size_t capacity;
+    std::size_t used;
+    std::size_t peak;
+    std::pmr::monotonic_buffer_resource overflow;
+    unsigned long long overflows;
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t align) override;
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+public:
+    static FrameArena frame; // game thread arena (reset after every tick)
+
+    FrameArena(std::size_t capacity) : buffer(new unsigned char[capacity]), capacity(capacity), used(0), peak(0), overflows(0) {}
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // release everything allocated since the last reset
+    void reset() {
+        used = 0;
+        overflow.release();
+    }
+
+    // bytes bumped since the last reset
+    std::size_t getUsed() const {
+        return used;
+    }
+
+    // most bytes used in a tick
+    std::size_t getPeak() const {
+        return peak;
+    }
+
+    std::size_t getCapacity() const {
+        return capacity;
+    }
+
+    // requests that didn't fit the buffer
+    unsigned long long getOverflows() const {
+        return overflows;
+    }
+};
+
+#endif
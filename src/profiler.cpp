@@ -0,0 +1,84 @@
+#include "./profiler.h"
+
+#if PROFILER
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+
+const Profiler::Clock::time_point Profiler::epoch = Profiler::Clock::now();
+std::mutex Profiler::registryMutex;
+std::vector<std::unique_ptr<Profiler::ThreadBuffer>> Profiler::buffers = std::vector<std::unique_ptr<Profiler::ThreadBuffer>>();
+thread_local const char* Profiler::currentZone = nullptr;
+
+Profiler::ThreadHandle::ThreadHandle() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    // reuse the buffer of an exited thread (short lived threads like parallel query workers come and go often)
+    for (std::unique_ptr<ThreadBuffer>& b : buffers) {
+        if (b->inUse) continue;
+        b->inUse = true;
+        b->depth = 0;
+        buffer = b.get();
+        return;
+    }
+    buffers.push_back(std::make_unique<ThreadBuffer>((int)buffers.size() + 1));
+    buffer = buffers.back().get();
+}
+
+Profiler::ThreadHandle::~ThreadHandle() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer->inUse = false;
+}
+
+static void writeString(std::ofstream& out, const char* s) {
+    out << '"';
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') out << '\\';
+        out << *s;
+    }
+    out << '"';
+}
+
+bool Profiler::exportChromeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) return false;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    std::vector<Zone> zones;
+    char number[64];
+    for (std::unique_ptr<ThreadBuffer>& b : buffers) {
+        // copy without stopping the writer, then drop whatever it may have overwritten meanwhile
+        std::uint64_t end = b->written.load(std::memory_order_acquire);
+        std::uint64_t begin = end > CAPACITY ? end - CAPACITY : 0;
+        zones.clear();
+        for (std::uint64_t i = begin; i < end; ++i) {
+            const Slot& slot = b->slots[i & (CAPACITY - 1)];
+            zones.push_back({ slot.name.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed),
+                slot.end.load(std::memory_order_relaxed), slot.depth.load(std::memory_order_relaxed) });
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        std::uint64_t written = b->written.load(std::memory_order_relaxed);
+        std::size_t skip = written + 1 > begin + CAPACITY ? (std::size_t)std::min<std::uint64_t>(written + 1 - CAPACITY - begin, zones.size()) : 0;
+
+        // thread name
+        const char* name = b->name.load(std::memory_order_relaxed);
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->id << ",\"args\":{\"name\":";
+        writeString(out, name ? name : ("thread " + std::to_string(b->id)).c_str());
+        out << "}}";
+        first = false;
+
+        // complete events (microseconds)
+        for (std::size_t i = skip; i < zones.size(); ++i) {
+            const Zone& z = zones[i];
+            out << ",\n{\"name\":";
+            writeString(out, z.name);
+            std::snprintf(number, sizeof(number), ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", b->id, z.start / 1000.0, (z.end - z.start) / 1000.0);
+            out << number;
+        }
+    }
+    out << "\n]}\n";
+    return (bool)out;
+}
+#endif
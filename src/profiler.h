@@ -0,0 +1,143 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#define PROFILER true // nested timing zones (compiled out entirely if false)
+
+#if PROFILER
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// hierarchical zone profiler
+// each thread records finished zones into its own ring buffer (no locks while recording), keeping the most recent ones
+// for export as a chrome trace (open in chrome://tracing or ui.perfetto.dev)
+class Profiler {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr std::size_t CAPACITY = 1 << 16; // zones kept per thread (power of two)
+
+    // finished zone (name must be a string literal or otherwise outlive the profiler)
+    struct Zone {
+        const char* name;
+        std::uint64_t start; // ns since profiler start
+        std::uint64_t end;
+        std::uint32_t depth; // nesting level on its thread
+    };
+
+    // times a scope
+    class Scope {
+    private:
+        const char* name;
+        const char* parent;
+        std::uint64_t start;
+    public:
+        Scope(const char* name) : name(name), parent(currentZone) {
+            threadBuffer().depth++;
+            currentZone = name;
+            start = now();
+        }
+
+        ~Scope() {
+            stop();
+        }
+
+        // end the zone early (for zones that don't match a block, later calls do nothing)
+        void stop() {
+            if (name == nullptr) return;
+            std::uint64_t end = now();
+            currentZone = parent;
+            ThreadBuffer& buffer = threadBuffer();
+            buffer.depth--;
+            buffer.push({ name, start, end, buffer.depth });
+            name = nullptr;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+private:
+    // ring entry (atomic fields so exporters can copy while the owner overwrites, torn copies are discarded)
+    struct Slot {
+        std::atomic<const char*> name;
+        std::atomic<std::uint64_t> start;
+        std::atomic<std::uint64_t> end;
+        std::atomic<std::uint32_t> depth;
+    };
+
+    // zones of one thread (single writer: the owning thread, readers: exporters)
+    struct ThreadBuffer {
+        std::unique_ptr<Slot[]> slots;
+        std::atomic<std::uint64_t> written;
+        std::uint32_t depth;
+        std::atomic<const char*> name;
+        int id;
+        bool inUse; // guarded by registryMutex
+
+        ThreadBuffer(int id) : slots(new Slot[CAPACITY]), written(0), depth(0), name(nullptr), id(id), inUse(true) {}
+
+        void push(const Zone& zone) {
+            std::uint64_t w = written.load(std::memory_order_relaxed);
+            Slot& slot = slots[w & (CAPACITY - 1)];
+            slot.name.store(zone.name, std::memory_order_relaxed);
+            slot.start.store(zone.start, std::memory_order_relaxed);
+            slot.end.store(zone.end, std::memory_order_relaxed);
+            slot.depth.store(zone.depth, std::memory_order_relaxed);
+            written.store(w + 1, std::memory_order_release);
+        }
+    };
+
+    // returns the buffer to the registry when its thread exits
+    struct ThreadHandle {
+        ThreadBuffer* buffer;
+
+        ThreadHandle();
+        ~ThreadHandle();
+    };
+
+    static const Clock::time_point epoch;
+    static std::mutex registryMutex; // only taken when threads start, exit or export
+    static std::vector<std::unique_ptr<ThreadBuffer>> buffers; // never shrinks (buffers of exited threads are reused)
+    static thread_local const char* currentZone; // innermost open zone of the calling thread
+
+    static ThreadBuffer& threadBuffer() {
+        thread_local ThreadHandle handle;
+        return *handle.buffer;
+    }
+public:
+    static std::uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count();
+    }
+
+    // innermost open zone of the calling thread (null if none, safe to call from allocation hooks)
+    static const char* zone() {
+        return currentZone;
+    }
+
+    // name shown for the calling thread (must outlive the profiler)
+    static void setThreadName(const char* name) {
+        threadBuffer().name.store(name, std::memory_order_relaxed);
+    }
+
+    // write recorded zones as chrome trace event json
+    static bool exportChromeTrace(const std::string& path);
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_ZONE_BEGIN(zone, name) Profiler::Scope zone(name) // zone ended by PROFILE_ZONE_END (or its scope)
+#define PROFILE_ZONE_END(zone) zone.stop()
+#define PROFILE_THREAD(name) Profiler::setThreadName(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_ZONE_BEGIN(zone, name)
+#define PROFILE_ZONE_END(zone)
+#define PROFILE_THREAD(name)
+#endif
+
+#endif
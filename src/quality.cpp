@@ -0,0 +1,55 @@
+#include "./quality.h"
+
+#include <cstring>
+
+const QualityGovernor::Settings QualityGovernor::SETTINGS[TIER_COUNT] = {
+    // outlines, back layer, death shrink, background, particles
+    { true, true, true, true, 1.f },
+    { false, true, true, true, 0.5f },
+    { false, false, false, true, 0.25f },
+    { false, false, false, false, 0.f },
+};
+
+const float QualityGovernor::DOWN_LOAD = 0.9f;
+const float QualityGovernor::UP_LOAD = 0.6f;
+const int QualityGovernor::DOWN_FRAMES = 20;
+const int QualityGovernor::UP_FRAMES = 180;
+const int QualityGovernor::COOLDOWN = 30;
+const float QualityGovernor::SMOOTHING = 0.1f;
+
+static const char* const NAMES[QualityGovernor::TIER_COUNT] = { "high", "medium", "low", "minimal" };
+
+bool QualityGovernor::record(float calcTime, float drawTime) {
+    calcAvg += (calcTime - calcAvg) * SMOOTHING;
+    drawAvg += (drawTime - drawAvg) * SMOOTHING;
+    if (!adaptive) return false;
+    if (cooldown > 0) {
+        cooldown--;
+        return false;
+    }
+
+    // the band between the loads counts for neither direction
+    float load = getLoad();
+    over = load > DOWN_LOAD ? over + 1 : 0;
+    under = load < UP_LOAD ? under + 1 : 0;
+    Tier next = tier;
+    if (over >= DOWN_FRAMES && tier != minimal) next = (Tier)(tier + 1);
+    else if (under >= UP_FRAMES && tier != high) next = (Tier)(tier - 1);
+    if (next == tier) return false;
+
+    tier = next;
+    over = under = 0;
+    cooldown = COOLDOWN;
+    changes++;
+    return true;
+}
+
+const char* QualityGovernor::name(Tier tier) {
+    return NAMES[tier];
+}
+
+int QualityGovernor::parse(const char* name) {
+    for (int i = 0; i < TIER_COUNT; ++i)
+        if (std::strcmp(name, NAMES[i]) == 0) return i;
+    return -1;
+}
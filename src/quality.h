@@ -0,0 +1,86 @@
+#ifndef QUALITY_H
+#define QUALITY_H
+
+// steps visual detail down when frames run over budget and back up when there is headroom again
+// tiers only change what gets drawn (and cosmetic particles), never the simulation, so gameplay keeps its fixed tick
+// rate and replays stay valid at any tier
+// hysteresis: stepping down needs the smoothed calc + draw time above DOWN_LOAD of the budget for DOWN_FRAMES frames in
+// a row, stepping up needs it below UP_LOAD for UP_FRAMES frames, and after a change the averages get COOLDOWN frames
+// to settle before anything is counted
+class QualityGovernor {
+public:
+    enum Tier {
+        high, // everything
+        medium, // no bullet outlines, half the particles
+        low, // no bullet back layer, dying bullets vanish instead of shrinking, a quarter of the particles
+        minimal, // no background, no effect particles
+    };
+    static constexpr int TIER_COUNT = minimal + 1;
+
+    // what a tier draws
+    struct Settings {
+        bool bulletOutlines;
+        bool bulletBackLayer;
+        bool deathShrink;
+        bool background;
+        float particleDensity; // fraction of effect particles emitted
+    };
+    static const Settings SETTINGS[TIER_COUNT];
+private:
+    static const float DOWN_LOAD;
+    static const float UP_LOAD;
+    static const int DOWN_FRAMES;
+    static const int UP_FRAMES;
+    static const int COOLDOWN;
+    static const float SMOOTHING; // weight of a new frame in the averages
+
+    float budget; // ms
+    float calcAvg; // ms
+    float drawAvg;
+    int over; // frames in a row above DOWN_LOAD
+    int under; // frames in a row below UP_LOAD
+    int cooldown;
+    Tier tier;
+    bool adaptive;
+    int changes;
+public:
+    QualityGovernor(float budget) : budget(budget), calcAvg(0), drawAvg(0), over(0), under(0), cooldown(0), tier(high), adaptive(true), changes(0) {}
+
+    // feed a frame's calc and draw time (ms), returns whether the tier changed
+    bool record(float calcTime, float drawTime);
+
+    // fix the tier (stops adapting)
+    void setTier(Tier tier) {
+        this->tier = tier;
+        adaptive = false;
+    }
+
+    void setAdaptive(bool adaptive) {
+        this->adaptive = adaptive;
+    }
+
+    Tier getTier() const {
+        return tier;
+    }
+
+    const Settings& getSettings() const {
+        return SETTINGS[tier];
+    }
+
+    // smoothed calc + draw time as a fraction of the budget
+    float getLoad() const {
+        return (calcAvg + drawAvg) / budget;
+    }
+
+    // tier changes since start
+    int getChanges() const {
+        return changes;
+    }
+
+    static const char* name(Tier tier);
+
+    // tier by name, or -1
+    static int parse(const char* name);
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "./renderer.h"
+
+// what sfml will submit for a drawable (shapes are checked first since bullets are circles)
+struct DrawableInfo {
+    RecordingRenderer::Command::Kind kind;
+    sf::PrimitiveType primitive;
+    int drawCalls;
+    std::size_t vertices;
+    const sf::Texture* texture;
+};
+
+static DrawableInfo inspect(const sf::Shape& shape) {
+    std::size_t points = shape.getPointCount();
+    bool outline = shape.getOutlineThickness() != 0;
+    return { RecordingRenderer::Command::shape, sf::TriangleFan, 1 + outline, points + 2 + (outline ? (points + 1) * 2 : 0), shape.getTexture() };
+}
+
+static DrawableInfo inspect(const sf::Sprite& sprite) {
+    return { RecordingRenderer::Command::sprite, sf::TriangleStrip, 1, 4, sprite.getTexture() };
+}
+
+static DrawableInfo inspect(const sf::Drawable& drawable, const sf::RenderStates& states) {
+    typedef RecordingRenderer::Command Command;
+    if (const sf::Shape* shape = dynamic_cast<const sf::Shape*>(&drawable))
+        return inspect(*shape);
+    if (const sf::Sprite* sprite = dynamic_cast<const sf::Sprite*>(&drawable))
+        return inspect(*sprite);
+    if (const sf::VertexArray* array = dynamic_cast<const sf::VertexArray*>(&drawable))
+        return { Command::vertexArray, array->getPrimitiveType(), array->getVertexCount() != 0, array->getVertexCount(), states.texture };
+    if (const sf::Text* text = dynamic_cast<const sf::Text*>(&drawable))
+        return { Command::text, sf::Triangles, 1 + (text->getOutlineThickness() != 0), text->getString().getSize() * 6, nullptr };
+    return { Command::drawable, sf::Points, 1, 0, states.texture };
+}
+
+void Renderer::count(int drawCalls, std::size_t vertices, const sf::Texture* texture, const sf::RenderStates& states) {
+    if (drawCalls == 0) return;
+    if (drawn && (texture != lastTexture || states.shader != lastShader || !(states.blendMode == lastBlend)))
+        stats.stateChanges++;
+    lastTexture = texture;
+    lastShader = states.shader;
+    lastBlend = states.blendMode;
+    drawn = true;
+    stats.drawCalls += drawCalls;
+    stats.vertices += vertices;
+}
+
+void Renderer::draw(const sf::Drawable& drawable, const sf::RenderStates& states) {
+    DrawableInfo info = inspect(drawable, states);
+    count(info.drawCalls, info.vertices, info.texture != nullptr ? info.texture : states.texture, states);
+    submit(drawable, states);
+}
+
+void Renderer::draw(const sf::Shape& shape, const sf::RenderStates& states) {
+    DrawableInfo info = inspect(shape);
+    count(info.drawCalls, info.vertices, info.texture != nullptr ? info.texture : states.texture, states);
+    submit(shape, states);
+}
+
+void Renderer::draw(const sf::Sprite& sprite, const sf::RenderStates& states) {
+    DrawableInfo info = inspect(sprite);
+    count(info.drawCalls, info.vertices, info.texture != nullptr ? info.texture : states.texture, states);
+    submit(sprite, states);
+}
+
+void Renderer::draw(const sf::Vertex* vertices, std::size_t count, sf::PrimitiveType type, const sf::RenderStates& states) {
+    this->count(count != 0, count, states.texture, states);
+    submit(vertices, count, type, states);
+}
+
+bool OffscreenRenderer::create(sf::Vector2u size, bool smooth) {
+    if (!texture.create(size.x, size.y)) return false;
+    texture.setSmooth(smooth);
+    sprite.setTexture(texture.getTexture(), true);
+    return true;
+}
+
+void OffscreenRenderer::present() {
+    texture.display();
+    const sf::View& view = output.getView();
+    sf::Vector2u size = texture.getSize();
+    sf::Transform trans;
+    trans.translate(view.getCenter() - view.getSize() * 0.5f);
+    trans.scale(view.getSize().x / size.x, view.getSize().y / size.y);
+    output.draw(sprite, trans);
+}
+
+void RecordingRenderer::submit(const sf::Drawable& drawable, const sf::RenderStates& states) {
+    if (!recording) return;
+    DrawableInfo info = inspect(drawable, states);
+    commands.push_back({ info.kind, info.primitive, info.vertices, info.texture != nullptr ? info.texture : states.texture, states.shader, states.blendMode, states.transform });
+}
+
+void RecordingRenderer::submit(const sf::Vertex* vertices, std::size_t count, sf::PrimitiveType type, const sf::RenderStates& states) {
+    if (!recording) return;
+    commands.push_back({ Command::vertices, type, count, states.texture, states.shader, states.blendMode, states.transform });
+}
+
+void RecordingRenderer::dump(std::ostream& out) const {
+    static const char* KINDS[] = { "sprite", "shape", "vertexArray", "text", "drawable", "vertices" };
+    static const char* PRIMITIVES[] = { "points", "lines", "lineStrip", "triangles", "triangleStrip", "triangleFan", "quads" };
+    for (std::size_t i = 0; i < commands.size(); ++i) {
+        const Command& c = commands[i];
+        const float* m = c.transform.getMatrix();
+        out << i << ' ' << KINDS[c.kind] << ' ' << PRIMITIVES[c.primitive] << " vertices " << c.vertexCount
+            << " texture " << c.texture << " shader " << c.shader
+            << " blend " << (c.blend == sf::BlendAlpha ? "alpha" : c.blend == sf::BlendAdd ? "add" : c.blend == sf::BlendNone ? "none" : "other")
+            << " at " << m[12] << ',' << m[13] << '\n';
+    }
+    out << "draw calls " << getStats().drawCalls << " vertices " << getStats().vertices << " state changes " << getStats().stateChanges << '\n';
+}
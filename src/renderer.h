@@ -0,0 +1,195 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <SFML/Graphics.hpp>
+
+#include <vector>
+#include <ostream>
+
+// rendering backend used by the scene graph
+// nodes draw through this instead of an sf::RenderTarget, so the draw path can run without a window or gl context
+// draw calls, vertices and state changes (texture, shader or blend mode differing from the previous draw) are counted for every backend
+class Renderer {
+public:
+    struct Stats {
+        int drawCalls; // as issued by sfml (a shape with an outline is two)
+        long long vertices;
+        int stateChanges;
+
+        Stats() : drawCalls(0), vertices(0), stateChanges(0) {}
+    };
+private:
+    Stats stats;
+    const sf::Texture* lastTexture;
+    const sf::Shader* lastShader;
+    sf::BlendMode lastBlend;
+    bool drawn; // anything drawn since stats were reset
+
+    void count(int drawCalls, std::size_t vertices, const sf::Texture* texture, const sf::RenderStates& states);
+protected:
+    virtual void submit(const sf::Drawable& drawable, const sf::RenderStates& states) = 0;
+    virtual void submit(const sf::Vertex* vertices, std::size_t count, sf::PrimitiveType type, const sf::RenderStates& states) = 0;
+public:
+    Renderer() : lastTexture(nullptr), lastShader(nullptr), drawn(false) {}
+    virtual ~Renderer() {}
+
+    void draw(const sf::Drawable& drawable, const sf::RenderStates& states = sf::RenderStates::Default);
+
+    void draw(const sf::Drawable& drawable, const sf::Transform& transform) {
+        draw(drawable, sf::RenderStates(transform));
+    }
+
+    // statically typed shapes and sprites are counted without probing the drawable's type
+    void draw(const sf::Shape& shape, const sf::RenderStates& states = sf::RenderStates::Default);
+
+    void draw(const sf::Shape& shape, const sf::Transform& transform) {
+        draw(shape, sf::RenderStates(transform));
+    }
+
+    void draw(const sf::Sprite& sprite, const sf::RenderStates& states = sf::RenderStates::Default);
+
+    void draw(const sf::Sprite& sprite, const sf::Transform& transform) {
+        draw(sprite, sf::RenderStates(transform));
+    }
+
+    void draw(const sf::Vertex* vertices, std::size_t count, sf::PrimitiveType type, const sf::RenderStates& states = sf::RenderStates::Default);
+
+    // clear the target and reset stats
+    virtual void clear(sf::Color color = sf::Color::Black) = 0;
+
+    virtual const sf::View& getView() const = 0;
+    virtual sf::Vector2u getSize() const = 0;
+
+    const Stats& getStats() const {
+        return stats;
+    }
+
+    void resetStats() {
+        stats = Stats();
+        drawn = false;
+    }
+};
+
+// draws to an sfml render target
+class SFMLRenderer : public Renderer {
+private:
+    sf::RenderTarget& target;
+protected:
+    void submit(const sf::Drawable& drawable, const sf::RenderStates& states) override {
+        target.draw(drawable, states);
+    }
+
+    void submit(const sf::Vertex* vertices, std::size_t count, sf::PrimitiveType type, const sf::RenderStates& states) override {
+        target.draw(vertices, count, type, states);
+    }
+public:
+    SFMLRenderer(sf::RenderTarget& target) : target(target) {}
+
+    void clear(sf::Color color = sf::Color::Black) override {
+        target.clear(color);
+        resetStats();
+    }
+
+    const sf::View& getView() const override {
+        return target.getView();
+    }
+
+    sf::Vector2u getSize() const override {
+        return target.getSize();
+    }
+};
+
+// draws into a texture with fewer pixels than the output (fill rate drops with the pixel count), present() stretches
+// it over the output's view with one sprite draw
+// the texture uses the output's view, so nodes and culling see the same coordinates as when drawing to the output
+class OffscreenRenderer : public Renderer {
+private:
+    Renderer& output;
+    sf::RenderTexture texture;
+    sf::Sprite sprite;
+protected:
+    void submit(const sf::Drawable& drawable, const sf::RenderStates& states) override {
+        texture.draw(drawable, states);
+    }
+
+    void submit(const sf::Vertex* vertices, std::size_t count, sf::PrimitiveType type, const sf::RenderStates& states) override {
+        texture.draw(vertices, count, type, states);
+    }
+public:
+    OffscreenRenderer(Renderer& output) : output(output) {}
+
+    // (re)create the texture at size pixels, smooth filters linearly when stretching (nearest otherwise)
+    bool create(sf::Vector2u size, bool smooth);
+
+    void clear(sf::Color color = sf::Color::Black) override {
+        texture.setView(output.getView());
+        texture.clear(color);
+        resetStats();
+    }
+
+    const sf::View& getView() const override {
+        return texture.getView();
+    }
+
+    sf::Vector2u getSize() const override {
+        return texture.getSize();
+    }
+
+    // finish the texture and draw it over the output's view
+    void present();
+};
+
+// draws nothing, only counts (and optionally records every draw until the next clear)
+class RecordingRenderer : public Renderer {
+public:
+    struct Command {
+        enum Kind {
+            sprite,
+            shape,
+            vertexArray,
+            text,
+            drawable, // other drawable
+            vertices // raw vertex pointer
+        } kind;
+        sf::PrimitiveType primitive;
+        std::size_t vertexCount;
+        const sf::Texture* texture;
+        const sf::Shader* shader;
+        sf::BlendMode blend;
+        sf::Transform transform;
+    };
+private:
+    sf::Vector2u size;
+    sf::View view;
+    std::vector<Command> commands; // capacity kept between frames
+protected:
+    void submit(const sf::Drawable& drawable, const sf::RenderStates& states) override;
+    void submit(const sf::Vertex* vertices, std::size_t count, sf::PrimitiveType type, const sf::RenderStates& states) override;
+public:
+    bool recording;
+
+    RecordingRenderer(sf::Vector2u size, bool recording = false) : size(size), view(sf::FloatRect(0, 0, (float)size.x, (float)size.y)), recording(recording) {}
+
+    void clear(sf::Color color = sf::Color::Black) override {
+        commands.clear();
+        resetStats();
+    }
+
+    const sf::View& getView() const override {
+        return view;
+    }
+
+    sf::Vector2u getSize() const override {
+        return size;
+    }
+
+    // draws since the last clear (empty unless recording)
+    const std::vector<Command>& getCommands() const {
+        return commands;
+    }
+
+    // one line per recorded draw, then the totals
+    void dump(std::ostream& out) const;
+};
+
+#endif
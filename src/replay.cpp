@@ -0,0 +1,134 @@
+#include "./replay.h"
+
+#include <algorithm>
+#include <fstream>
+
+const char Replay::MAGIC[4] = { 'S', 'F', 'R', 'P' };
+
+static std::uint64_t bits(const Input::ActionSet& set) {
+    return set.to_ullong();
+}
+
+// fixed size fields are little endian
+static void writeU64(std::ofstream& out, std::uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i)
+        out.put((char)(v >> (i * 8)));
+}
+
+static std::uint64_t readU64(std::ifstream& in, int bytes) {
+    std::uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i)
+        v |= (std::uint64_t)(std::uint8_t)in.get() << (i * 8);
+    return v;
+}
+
+void Replay::writeVarint(std::uint64_t v) {
+    while (v >= 0x80) {
+        data.push_back((std::uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    data.push_back((std::uint8_t)v);
+}
+
+std::uint64_t Replay::readVarint() {
+    std::uint64_t v = 0;
+    for (int shift = 0; readPos < data.size() && shift < 64; shift += 7) {
+        std::uint8_t b = data[readPos++];
+        v |= (std::uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    return v;
+}
+
+void Replay::begin(std::uint64_t seed) {
+    this->seed = seed;
+    ticks = 0;
+    data.clear();
+    data.reserve(1 << 16); // recording doesn't allocate in a frame until hours of input
+    last = Input::Snapshot();
+    unchanged = 0;
+    readPos = 0;
+    played = 0;
+    pendingRun = 0;
+    runLoaded = false;
+}
+
+void Replay::record(const Input::Snapshot& snapshot) {
+    ticks++;
+    if (snapshot == last) {
+        unchanged++;
+        return;
+    }
+
+    // run, mask of changed sets, then each changed set xored with the previous tick
+    std::uint64_t diff[3] = { bits(snapshot.pressed) ^ bits(last.pressed), bits(snapshot.justPressed) ^ bits(last.justPressed), bits(snapshot.justReleased) ^ bits(last.justReleased) };
+    writeVarint(unchanged);
+    data.push_back((std::uint8_t)((diff[0] != 0) | (diff[1] != 0) << 1 | (diff[2] != 0) << 2));
+    for (std::uint64_t d : diff)
+        if (d != 0) writeVarint(d);
+    last = snapshot;
+    unchanged = 0;
+}
+
+bool Replay::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    out.write(MAGIC, 4);
+    writeU64(out, VERSION, 4);
+    writeU64(out, seed, 8);
+    writeU64(out, ticks, 4);
+    writeU64(out, data.size(), 4);
+    out.write((const char*)data.data(), data.size());
+    return (bool)out;
+}
+
+bool Replay::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[4];
+    if (!in.read(magic, 4) || !std::equal(magic, magic + 4, MAGIC)) return false;
+    if (readU64(in, 4) != VERSION || !in) return false;
+    std::uint64_t fileSeed = readU64(in, 8);
+    std::uint32_t fileTicks = (std::uint32_t)readU64(in, 4);
+    std::uint64_t size = readU64(in, 4);
+    if (!in) return false;
+
+    // a corrupt size must not allocate before the read fails
+    std::streamoff start = in.tellg();
+    if (!in.seekg(0, std::ios::end)) return false;
+    std::streamoff end = in.tellg();
+    if (start < 0 || end < start || size > (std::uint64_t)(end - start) || !in.seekg(start)) return false;
+
+    begin(fileSeed);
+    ticks = fileTicks;
+    data.resize(size);
+    in.read((char*)data.data(), data.size());
+    return (bool)in;
+}
+
+bool Replay::next(Input::Snapshot& snapshot) {
+    if (finished()) return false;
+    played++;
+
+    // ticks after the last change repeat it
+    if (readPos == data.size() && !runLoaded) {
+        snapshot = last;
+        return true;
+    }
+    if (!runLoaded) {
+        pendingRun = (std::uint32_t)readVarint();
+        runLoaded = true;
+    }
+    if (pendingRun != 0) {
+        pendingRun--;
+        snapshot = last;
+        return true;
+    }
+
+    std::uint8_t mask = readPos < data.size() ? data[readPos++] : 0;
+    Input::ActionSet* sets[3] = { &last.pressed, &last.justPressed, &last.justReleased };
+    for (int i = 0; i < 3; ++i)
+        if (mask & (1 << i))
+            *sets[i] ^= Input::ActionSet(readVarint());
+    runLoaded = false;
+    snapshot = last;
+    return true;
+}
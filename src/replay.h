@@ -0,0 +1,71 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "./input.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// recorded run: rng seed plus the input snapshot of every tick
+// snapshots are delta encoded (run of unchanged ticks, then the changed words xored with the previous tick as varints),
+// so idle ticks cost nothing and a key press costs a few bytes
+class Replay {
+private:
+    static const char MAGIC[4];
+    static constexpr std::uint32_t VERSION = 1;
+
+    std::uint64_t seed;
+    std::uint32_t ticks;
+    std::vector<std::uint8_t> data;
+
+    // recording
+    Input::Snapshot last;
+    std::uint32_t unchanged; // ticks since the last change
+
+    // playback
+    std::size_t readPos;
+    std::uint32_t played;
+    std::uint32_t pendingRun; // unchanged ticks left before the next change
+    bool runLoaded;
+
+    void writeVarint(std::uint64_t v);
+    std::uint64_t readVarint();
+public:
+    Replay() {
+        begin(1);
+    }
+
+    // start recording a run
+    void begin(std::uint64_t seed);
+
+    // append the snapshot of the next tick
+    void record(const Input::Snapshot& snapshot);
+
+    bool save(const std::string& path) const;
+
+    // load and rewind for playback
+    bool load(const std::string& path);
+
+    // snapshot of the next tick (false once every recorded tick was played)
+    bool next(Input::Snapshot& snapshot);
+
+    bool finished() const {
+        return played >= ticks;
+    }
+
+    std::uint64_t getSeed() const {
+        return seed;
+    }
+
+    std::uint32_t getTicks() const {
+        return ticks;
+    }
+
+    // encoded input size in bytes
+    std::size_t size() const {
+        return data.size();
+    }
+};
+
+#endif
@@ -0,0 +1,3 @@
+#include "./rng.h"
+
+Rng Rng::game = Rng();
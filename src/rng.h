@@ -0,0 +1,48 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+// deterministic random numbers (pcg32)
+// std distributions are implementation defined, so floats are made here to get the same sequence on every platform
+class Rng {
+private:
+    std::uint64_t state;
+public:
+    static Rng game; // simulation stream (seeded from the replay seed, saved with world snapshots)
+
+    Rng(std::uint64_t seed = 1) {
+        reseed(seed);
+    }
+
+    void reseed(std::uint64_t seed) {
+        // splitmix64 so nearby seeds start far apart
+        std::uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        state = z ^ (z >> 31);
+    }
+
+    std::uint32_t next() {
+        std::uint64_t old = state;
+        state = old * 6364136223846793005ull + 1442695040888963407ull;
+        std::uint32_t xorshifted = (std::uint32_t)(((old >> 18) ^ old) >> 27);
+        std::uint32_t rot = (std::uint32_t)(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31));
+    }
+
+    // uniform in [min, max)
+    float uniform(float min, float max) {
+        return min + (max - min) * ((next() >> 8) * (1.f / 16777216.f));
+    }
+
+    std::uint64_t getState() const {
+        return state;
+    }
+
+    void setState(std::uint64_t state) {
+        this->state = state;
+    }
+};
+
+#endif
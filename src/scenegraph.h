@@ -2,26 +2,65 @@
 #define SCENEGRAPH_H
 
 #include "./nodes.h"
+#include "./profiler.h"
 
 // scene graph
 class SceneGraph {
 private:
 public:
     std::shared_ptr<Node> root;
-    sf::RenderTarget* renderTarget;
+    std::shared_ptr<Node> hud; // drawn on top of root, always at the output's resolution (overlay, text)
+    Renderer* renderer;
+    OffscreenRenderer* offscreen; // root is drawn here and stretched over the output if set (reduced resolution)
+    bool cull; // skip subtrees with bounds outside of the view
 
-    SceneGraph(sf::RenderTarget& renderTarget) {
-        this->renderTarget = &renderTarget;
-        root = std::make_shared<Node>();
+    SceneGraph(Renderer& renderer) : offscreen(nullptr), cull(true) {
+        this->renderer = &renderer;
+        root = Node::create();
+        hud = Node::create();
     }
 
     void drawTick(int calcTick) {
-        renderTarget->clear();
-        root->draw(*renderTarget, sf::Transform::Identity, calcTick);
+        PROFILE_ZONE("SceneGraph::drawTick");
+        Renderer& scene = offscreen != nullptr ? *offscreen : *renderer;
+        {
+            PROFILE_ZONE("clear");
+            renderer->clear();
+            if (offscreen != nullptr) offscreen->clear();
+        }
+
+        // cull against the area covered by the current view
+        Node::drawStats = Node::DrawStats();
+        Node::cullEnabled = cull;
+        Node::cullRect = scene.getView().getInverseTransform().transformRect(sf::FloatRect(-1, -1, 2, 2));
+
+        {
+            PROFILE_ZONE("traverse");
+            root->draw(scene, sf::Transform::Identity, calcTick);
+        }
+        if (offscreen != nullptr) {
+            PROFILE_ZONE("upscale");
+            offscreen->present();
+        }
+        hud->draw(*renderer, sf::Transform::Identity, calcTick);
+
+        Node::drawStats.drawCalls = renderer->getStats().drawCalls;
+        Node::drawStats.vertices = renderer->getStats().vertices;
+        Node::drawStats.stateChanges = renderer->getStats().stateChanges;
+        if (offscreen != nullptr) {
+            Node::drawStats.drawCalls += offscreen->getStats().drawCalls;
+            Node::drawStats.vertices += offscreen->getStats().vertices;
+            Node::drawStats.stateChanges += offscreen->getStats().stateChanges;
+        }
+    }
+
+    // counters of the last draw tick
+    const Node::DrawStats& getDrawStats() {
+        return Node::drawStats;
     }
 
     static std::shared_ptr<Node> create() {
-        return std::make_shared<Node>();
+        return Node::create();
     }
 };
 
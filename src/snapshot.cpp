@@ -0,0 +1,61 @@
+#include "./snapshot.h"
+#include "./bullets.h"
+#include "./bulletscript.h"
+#include "./lasers.h"
+#include "./player.h"
+#include "./rng.h"
+#include "./timeline.h"
+#include "./profiler.h"
+
+void WorldSnapshot::capture(int tick) {
+    PROFILE_ZONE("WorldSnapshot::capture");
+    this->tick = tick;
+    data.clear();
+    bullets.assign(Bullet::bullets.begin(), Bullet::bullets.end());
+    scripts.clear();
+    timelineActions.clear();
+
+    SnapshotWriter out(data);
+    out.write(Rng::game.getState());
+    out.write(Player::pos);
+    out.write(Player::charge);
+    Timeline::stage.saveState(out, timelineActions);
+    for (const std::shared_ptr<Bullet>& b : bullets) {
+        scripts.push_back(b->script);
+        b->saveState(out);
+    }
+
+    straightLasers.assign(StraightLaser::lasers.begin(), StraightLaser::lasers.end());
+    for (const std::shared_ptr<StraightLaser>& laser : straightLasers)
+        laser->saveState(out);
+    curvyLasers.assign(CurvyLaser::lasers.begin(), CurvyLaser::lasers.end());
+    for (const std::shared_ptr<CurvyLaser>& laser : curvyLasers)
+        laser->saveState(out);
+}
+
+int WorldSnapshot::restore() const {
+    PROFILE_ZONE("WorldSnapshot::restore");
+    SnapshotReader in(data.data());
+    std::uint64_t rngState;
+    in.read(rngState);
+    Rng::game.setState(rngState);
+    in.read(Player::pos);
+    in.read(Player::charge);
+    Timeline::stage.loadState(in, timelineActions);
+
+    // bullets spawned after the capture are dropped, removed ones come back (in their original draw order)
+    Bullet::bullets.assign(bullets.begin(), bullets.end());
+    for (std::size_t i = 0; i < bullets.size(); ++i) {
+        bullets[i]->script = scripts[i];
+        bullets[i]->loadState(in);
+    }
+    Bullet::attachAll();
+
+    StraightLaser::lasers.assign(straightLasers.begin(), straightLasers.end());
+    for (const std::shared_ptr<StraightLaser>& laser : straightLasers)
+        laser->loadState(in);
+    CurvyLaser::lasers.assign(curvyLasers.begin(), curvyLasers.end());
+    for (const std::shared_ptr<CurvyLaser>& laser : curvyLasers)
+        laser->loadState(in);
+    return tick;
+}
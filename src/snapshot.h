@@ -0,0 +1,136 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+class Bullet;
+class BulletScript;
+class StraightLaser;
+class CurvyLaser;
+
+// appends plain values to a snapshot buffer (no allocation once the buffer has grown to its working size)
+// the buffer is used up to its capacity while writing and trimmed to the written size when the writer goes away
+class SnapshotWriter {
+private:
+    std::vector<std::uint8_t>& data;
+    std::size_t written;
+public:
+    SnapshotWriter(std::vector<std::uint8_t>& data) : data(data), written(0) {
+        data.resize(data.capacity());
+    }
+
+    ~SnapshotWriter() {
+        data.resize(written);
+    }
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    template <typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot values must be trivially copyable");
+        if (written + sizeof(T) > data.size()) data.resize(std::max<std::size_t>(data.size() * 2, 4096));
+        std::memcpy(&data[written], &value, sizeof(T));
+        written += sizeof(T);
+    }
+};
+
+// reads values back in the order they were written
+class SnapshotReader {
+private:
+    const std::uint8_t* pos;
+public:
+    SnapshotReader(const std::uint8_t* pos) : pos(pos) {}
+
+    template <typename T>
+    void read(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot values must be trivially copyable");
+        std::memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+    }
+};
+
+// simulation state at a tick boundary (bullets with their script state, lasers, player, stage timeline, rng and tick)
+// state is copied into one contiguous buffer; bullet and laser objects and script trees are only referenced (kept alive by the snapshot)
+// and get their state written back on restore, so capture and restore never rebuild the object graph
+// note: particles are cosmetic and not included, generic scripts' captured variables are not saved
+class WorldSnapshot {
+private:
+    std::vector<std::uint8_t> data;
+    std::vector<std::shared_ptr<Bullet>> bullets;
+    std::vector<std::shared_ptr<BulletScript>> scripts; // script of each bullet
+    std::vector<std::shared_ptr<StraightLaser>> straightLasers;
+    std::vector<std::shared_ptr<CurvyLaser>> curvyLasers;
+    std::vector<std::shared_ptr<std::function<void(int)>>> timelineActions; // actions of the pending stage events (Timeline::ActionPtr)
+    int tick;
+public:
+    WorldSnapshot() : tick(-1) {}
+
+    void capture(int tick);
+
+    // put the world back into the captured state and return the captured tick
+    int restore() const;
+
+    int getTick() const {
+        return tick;
+    }
+
+    // state bytes
+    std::size_t size() const {
+        return data.size();
+    }
+
+    // raw state (equal bytes mean equal simulation state)
+    const std::vector<std::uint8_t>& bytes() const {
+        return data;
+    }
+};
+
+// last N snapshots (capacity of slots is reused, so steady state capture doesn't allocate)
+class SnapshotRing {
+private:
+    std::vector<WorldSnapshot> snapshots;
+    int newest;
+    int count;
+public:
+    SnapshotRing(int capacity) : snapshots(capacity), newest(-1), count(0) {}
+
+    // capture into the oldest slot
+    void capture(int tick) {
+        newest = (newest + 1) % (int)snapshots.size();
+        snapshots[newest].capture(tick);
+        if (count < (int)snapshots.size()) count++;
+    }
+
+    // restore the newest snapshot and drop it (returns its tick, -1 if empty)
+    int pop() {
+        if (count == 0) return -1;
+        int tick = snapshots[newest].restore();
+        newest = (newest + (int)snapshots.size() - 1) % (int)snapshots.size();
+        count--;
+        return tick;
+    }
+
+    // snapshot ticksAgo captures back (0 is the newest, null if not kept)
+    const WorldSnapshot* get(int ticksAgo) const {
+        if (ticksAgo < 0 || ticksAgo >= count) return nullptr;
+        return &snapshots[(newest + (int)snapshots.size() - ticksAgo) % (int)snapshots.size()];
+    }
+
+    int size() const {
+        return count;
+    }
+
+    void clear() {
+        newest = -1;
+        count = 0;
+    }
+};
+
+#endif
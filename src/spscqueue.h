@@ -0,0 +1,51 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// bounded lock-free queue for exactly one producer thread and one consumer thread
+// (push fails instead of blocking when full, capacity must be a power of two)
+template <typename T, std::size_t CAPACITY>
+class SpscQueue {
+    static_assert(CAPACITY != 0 && (CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+private:
+    static constexpr std::size_t MASK = CAPACITY - 1;
+
+    T items[CAPACITY];
+    alignas(64) std::atomic<std::size_t> head; // next item to pop (written by consumer)
+    alignas(64) std::atomic<std::size_t> tail; // next slot to push (written by producer)
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // producer only (returns false if full)
+    bool push(const T& item) {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == CAPACITY) return false;
+        items[t & MASK] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only (returns false if empty)
+    bool pop(T& item) {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        item = items[h & MASK];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    std::size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include "./telemetry.h"
+#include "./profiler.h"
+
+#include <chrono>
+
+SpscQueue<FrameStats, Telemetry::QUEUE_CAPACITY> Telemetry::queue;
+std::atomic<bool> Telemetry::running(false);
+std::atomic<long long> Telemetry::dropped(0);
+std::thread Telemetry::writer;
+std::string Telemetry::path;
+Telemetry::Format Telemetry::format = Telemetry::csv;
+long long Telemetry::rotateRecords = 0;
+std::FILE* Telemetry::file = nullptr;
+std::vector<char> Telemetry::fileBuffer;
+int Telemetry::fileIndex = 0;
+long long Telemetry::fileRecords = 0;
+
+static const char CSV_HEADER[] = "tick,input_ms,calc_ms,draw_ms,frame_ms,bullets,spawned,removed,nodes,culled,draw_calls,voices,audio_drops,script_instructions,allocations,pool_blocks,pool_capacity,arena_bytes,jitter_p50_ms,jitter_p99_ms,jitter_max_ms,quality\n";
+
+Telemetry::Format Telemetry::formatOf(const std::string& path) {
+    std::size_t dot = path.rfind('.');
+    std::string extension = dot == std::string::npos ? "" : path.substr(dot);
+    return extension == ".jsonl" || extension == ".json" ? jsonl : csv;
+}
+
+bool Telemetry::openFile() {
+    std::string name = path;
+    if (fileIndex != 0) {
+        std::size_t dot = path.rfind('.');
+        std::size_t slash = path.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) dot = path.size();
+        name = path.substr(0, dot) + "." + std::to_string(fileIndex) + path.substr(dot);
+    }
+    file = std::fopen(name.c_str(), "w");
+    if (file == nullptr) return false;
+    std::setvbuf(file, fileBuffer.data(), _IOFBF, fileBuffer.size());
+    if (format == csv) std::fputs(CSV_HEADER, file);
+    fileRecords = 0;
+    return true;
+}
+
+void Telemetry::write(const FrameStats& f) {
+    if (rotateRecords > 0 && fileRecords == rotateRecords) {
+        std::fclose(file);
+        fileIndex++;
+        if (!openFile()) return;
+    }
+    if (format == csv) {
+        std::fprintf(file, "%d,%.3f,%.3f,%.3f,%.3f,%d,%d,%d,%d,%d,%d,%d,%d,%lld,%lld,%d,%d,%d,%.3f,%.3f,%.3f,%d\n",
+            f.tick, f.inputTime, f.calcTime, f.drawTime, f.frameTime, f.bullets, f.spawned, f.removed, f.nodes, f.culled, f.drawCalls, f.voices, f.audioDrops,
+            f.scriptInstructions, f.allocations, f.poolBlocks, f.poolCapacity, f.arenaBytes, f.jitterP50, f.jitterP99, f.jitterMax, f.quality);
+    } else {
+        std::fprintf(file, "{\"tick\":%d,\"input_ms\":%.3f,\"calc_ms\":%.3f,\"draw_ms\":%.3f,\"frame_ms\":%.3f,\"bullets\":%d,\"spawned\":%d,\"removed\":%d,"
+            "\"nodes\":%d,\"culled\":%d,\"draw_calls\":%d,\"voices\":%d,\"audio_drops\":%d,\"script_instructions\":%lld,\"allocations\":%lld,\"pool_blocks\":%d,\"pool_capacity\":%d,\"arena_bytes\":%d,"
+            "\"jitter_p50_ms\":%.3f,\"jitter_p99_ms\":%.3f,\"jitter_max_ms\":%.3f,\"quality\":%d}\n",
+            f.tick, f.inputTime, f.calcTime, f.drawTime, f.frameTime, f.bullets, f.spawned, f.removed, f.nodes, f.culled, f.drawCalls, f.voices, f.audioDrops,
+            f.scriptInstructions, f.allocations, f.poolBlocks, f.poolCapacity, f.arenaBytes, f.jitterP50, f.jitterP99, f.jitterMax, f.quality);
+    }
+    fileRecords++;
+}
+
+void Telemetry::writerLoop() {
+    PROFILE_THREAD("telemetry");
+    FrameStats stats;
+    while (true) {
+        // read running before draining, so records queued before close() are never left behind
+        bool stop = !running.load(std::memory_order_acquire);
+        bool wrote = false;
+        while (queue.pop(stats)) {
+            if (file != nullptr) write(stats);
+            wrote = true;
+        }
+        if (stop) break;
+        if (wrote && file != nullptr) std::fflush(file);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    if (file != nullptr) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+bool Telemetry::open(const std::string& path, Format format, long long rotateRecords) {
+    close();
+    Telemetry::path = path;
+    Telemetry::format = format;
+    Telemetry::rotateRecords = rotateRecords;
+    fileBuffer.resize(1 << 16);
+    fileIndex = 0;
+    if (!openFile()) return false;
+    running.store(true, std::memory_order_release);
+    writer = std::thread(writerLoop);
+    return true;
+}
+
+void Telemetry::close() {
+    if (!running.load(std::memory_order_relaxed)) return;
+    running.store(false, std::memory_order_release);
+    writer.join();
+}
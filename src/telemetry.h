@@ -0,0 +1,65 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "./framestats.h"
+#include "./spscqueue.h"
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// per frame telemetry written to csv or jsonl (one record per line)
+// the game thread only copies the record into a preallocated queue, formatting and file io happen on a writer thread
+class Telemetry {
+public:
+    enum Format {
+        csv,
+        jsonl
+    };
+private:
+    static constexpr std::size_t QUEUE_CAPACITY = 4096; // frames buffered (over a minute at 60fps)
+
+    static SpscQueue<FrameStats, QUEUE_CAPACITY> queue;
+    static std::atomic<bool> running;
+    static std::atomic<long long> dropped; // records lost to a full queue
+    static std::thread writer;
+    static std::string path;
+    static Format format;
+    static long long rotateRecords;
+    static std::FILE* file;
+    static std::vector<char> fileBuffer;
+    static int fileIndex;
+    static long long fileRecords;
+
+    static bool openFile();
+    static void write(const FrameStats& stats);
+    static void writerLoop();
+public:
+    // start writing to path (rotate after this many records into path.1, path.2... before the extension, 0 to never rotate)
+    // returns false if the file can't be opened
+    static bool open(const std::string& path, Format format, long long rotateRecords = 0);
+
+    // write remaining records and stop the writer
+    static void close();
+
+    static bool isOpen() {
+        return running.load(std::memory_order_relaxed);
+    }
+
+    // queue a record (never blocks or allocates, drops the record if the writer fell behind)
+    static void record(const FrameStats& stats) {
+        if (!running.load(std::memory_order_relaxed)) return;
+        if (!queue.push(stats)) dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static long long getDropped() {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    // jsonl if path ends in .jsonl or .json, else csv
+    static Format formatOf(const std::string& path);
+};
+
+#endif
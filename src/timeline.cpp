@@ -0,0 +1,77 @@
+#include "./timeline.h"
+#include "./profiler.h"
+
+#include <algorithm>
+#include <climits>
+
+Timeline Timeline::stage;
+
+void Timeline::tick(int tick) {
+    now = tick;
+    if (queue.empty() || queue.front().tick > tick) return; // nothing due (checked before profiling, most ticks end here)
+    PROFILE_ZONE("Timeline::tick");
+    while (!queue.empty() && queue.front().tick <= tick) {
+        std::pop_heap(queue.begin(), queue.end(), later);
+        Due due = queue.back();
+        queue.pop_back();
+        Event& event = events[due.event];
+        if (event.remaining == 0) { // cancelled
+            release(due.event);
+            continue;
+        }
+
+        // queue the next run first, so the action can cancel its own event
+        if (event.remaining != FOREVER) event.remaining--;
+        bool again = event.remaining != 0;
+        if (again) push(due.tick + event.interval, due.event);
+        (*event.action)(due.tick);
+        if (!again) release(due.event);
+    }
+}
+
+int Timeline::nextTick() const {
+    return queue.empty() ? INT_MAX : queue.front().tick;
+}
+
+void Timeline::saveState(SnapshotWriter& out, std::vector<ActionPtr>& actions) {
+    // every id in use has exactly one queued entry, so the queue covers every pending event
+    out.write(order);
+    out.write(now);
+    out.write(events.size());
+    out.write(freeIds.size());
+    for (int id : freeIds)
+        out.write(id);
+    out.write(queue.size());
+    for (const Due& due : queue) {
+        const Event& event = events[due.event];
+        out.write(due);
+        out.write(event.interval);
+        out.write(event.remaining);
+        actions.push_back(event.action);
+    }
+}
+
+void Timeline::loadState(SnapshotReader& in, const std::vector<ActionPtr>& actions) {
+    in.read(order);
+    in.read(now);
+    std::size_t count;
+    in.read(count);
+    events.resize(count);
+    for (Event& event : events) {
+        event.action = nullptr;
+        event.remaining = 0;
+    }
+    in.read(count);
+    freeIds.resize(count);
+    for (int& id : freeIds)
+        in.read(id);
+    in.read(count);
+    queue.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        in.read(queue[i]);
+        Event& event = events[queue[i].event];
+        in.read(event.interval);
+        in.read(event.remaining);
+        event.action = actions[i];
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include "./snapshot.h"
+#include "./pool.h"
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// stage events ordered by the tick they are due (spawn patterns, lasers, sounds, music changes...)
+// due events are kept in a binary heap, so a tick only touches the events that run on it and a stage with thousands
+// of scheduled events costs one comparison on ticks where nothing happens
+// events are run in tick order, events due on the same tick in the order they were scheduled
+// ids of finished events are reused, so a long stage only keeps (and snapshots) the events still pending
+// the schedule is part of world snapshots, rewinding puts back what is due (actions are only referenced, kept alive by
+// the snapshot, events scheduled after a snapshot are dropped when it is restored)
+class Timeline {
+public:
+    typedef std::function<void(int tick)> Action;
+    typedef std::shared_ptr<Action> ActionPtr;
+    static constexpr int FOREVER = -1;
+private:
+    struct Event {
+        ActionPtr action; // null if the id is free
+        int interval; // ticks between runs
+        int remaining; // runs left (FOREVER repeats until cancelled, 0 is finished or cancelled)
+    };
+
+    // event due at a tick (order breaks ties between entries due on the same tick)
+    struct Due {
+        int tick;
+        int event;
+        long long order;
+    };
+
+    // heap order (std heaps put the largest entry first, so the latest entry compares smallest)
+    static bool later(const Due& a, const Due& b) {
+        return a.tick > b.tick || (a.tick == b.tick && a.order > b.order);
+    }
+
+    std::deque<Event> events; // indexed by id (a deque so actions scheduling events don't move the running one)
+    std::vector<int> freeIds; // ids of finished events (reused last in, first out)
+    std::vector<Due> queue; // heap of due entries, exactly one per id in use
+    long long order;
+    int now; // tick being run (or the last one run)
+
+    void push(int tick, int event) {
+        queue.push_back({ tick, event, order++ });
+        std::push_heap(queue.begin(), queue.end(), later);
+    }
+
+    // free the id of an event whose entry was taken off the queue without being queued again
+    void release(int event) {
+        events[event].action = nullptr;
+        events[event].remaining = 0;
+        freeIds.push_back(event);
+    }
+public:
+    static Timeline stage; // timeline of the running stage
+
+    Timeline() : order(0), now(0) {}
+
+    // run action once at tick (returns the event id)
+    int at(int tick, Action action) {
+        return every(tick, 1, 1, action);
+    }
+
+    // run action delay ticks after the current tick (0 is still this tick when called from an action)
+    int after(int delay, Action action) {
+        return at(now + delay, action);
+    }
+
+    // run action at start and then every interval ticks, times times (or FOREVER)
+    int every(int start, int interval, int times, Action action) {
+        if (interval < 1) throw("timeline events need an interval of at least a tick");
+        int id;
+        if (freeIds.empty()) {
+            id = (int)events.size();
+            events.emplace_back();
+        }
+        else {
+            id = freeIds.back();
+            freeIds.pop_back();
+        }
+        events[id] = { makePooled<Action>(std::move(action)), interval, times };
+        push(start, id);
+        return id;
+    }
+
+    // stop an event from running again (its queued entry is dropped when it comes up)
+    // ids are reused once an event has finished, so only cancel events that are still pending
+    void cancel(int event) {
+        events[event].remaining = 0;
+    }
+
+    // run every event due at or before tick
+    void tick(int tick);
+
+    // tick the next event is due (INT_MAX if there is none)
+    int nextTick() const;
+
+    // events waiting to run
+    int size() const {
+        return (int)queue.size();
+    }
+
+    // drop every event
+    void clear() {
+        events.clear();
+        freeIds.clear();
+        queue.clear();
+        order = 0;
+        now = 0;
+    }
+
+    // actions of the pending events are appended to actions (in queue order) instead of being written
+    void saveState(SnapshotWriter& out, std::vector<ActionPtr>& actions);
+    void loadState(SnapshotReader& in, const std::vector<ActionPtr>& actions);
+};
+
+#endif